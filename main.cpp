@@ -4,9 +4,38 @@
 #include <utility>
 #include <vector>
 #include <map>
+#include <deque>
+#include <set>
+#include <unordered_map>
 #include <algorithm> // for std::find
+#include <atomic>
+#include <charconv>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string_view>
 #include "tinyxml2.h"
 #include <string>
+#ifdef _WIN32
+#include <io.h>
+#define fsyncFile(f) _commit(_fileno(f))
+#define truncateFile(f, size) _chsize_s(_fileno(f), size)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define fsyncFile(f) fsync(fileno(f))
+#define truncateFile(f, size) ftruncate(fileno(f), size)
+#endif
 
 
 #define MIN_START_HOUR 7
@@ -26,20 +55,16 @@ class ClassroomList;
 class Lesson;
 class LessonList;
 
+// The message is only built when what() is first called
 class range_error : public std::exception {
-    std::string message;
+    mutable std::string message;
     int minValue;
     int maxValue;
-    char* charStar;
 
 public:
     range_error(int minValue, int maxValue)
-            : minValue(minValue), maxValue(maxValue) {
-        message = "Out of range error: Range: [" + std::to_string(minValue) + " - " + std::to_string(maxValue) + "]";
-    }
-    const char* what() {
-        return message.c_str();
-    }
+            : minValue(minValue), maxValue(maxValue) {}
+    const char* what() const noexcept override;
     int getMinValue() const {
         return minValue;
     }
@@ -48,29 +73,50 @@ public:
     }
 };
 
+// Carries the clashing lessons, classroom and time; the message is only built when what() is first called.
+// at is the start of the booked session as a minute of the week (see WeekTime::minuteOfWeek).
 class conflict_error : public std::exception {
-    std::string with;
-    std::string at;
-    std::string message;
+    int at;
+    int lessonId;
+    int otherLessonId;
+    int classroom = -1;
+    bool selfLesson = false;
+    mutable std::string message;
 
 public:
-    explicit conflict_error(std::string  at) : at(std::move(at)) {}
-    const char* what() const noexcept override {
-        return message.c_str();
+    explicit conflict_error(int at, int lessonId = -1, int otherLessonId = -1)
+            : at(at), lessonId(lessonId), otherLessonId(otherLessonId) {}
+    const char* what() const noexcept override;
+    std::string getWith() const;
+    std::string getAt() const;
+    int getAtMinute() const {
+        return at;
     }
-    const std::string &getWith() const {
-        return with;
+    // the lesson being placed
+    int getLessonId() const {
+        return lessonId;
     }
-    void setWith(const std::string &w) {
-        with = w;
-        message = "Conflict Error with: " + with + " at " + at;
+    void setLessonId(int id) {
+        lessonId = id;
+        message.clear();
     }
-    const std::string &getAt() const {
-        return at;
+    // the lesson already holding the time
+    int getOtherLessonId() const {
+        return otherLessonId;
+    }
+    int getClassroom() const {
+        return classroom;
+    }
+    void setClassroom(int number) {
+        classroom = number;
+        message.clear();
     }
-    void setAt(const std::string &a) {
-        at = a;
-        message = "Conflict Error with: " + with + " at " + at;
+    bool isSelfLesson() const {
+        return selfLesson;
+    }
+    void setSelfLesson() {
+        selfLesson = true;
+        message.clear();
     }
 };
 
@@ -103,6 +149,56 @@ void sort(std::vector<T>& vec, int (T::*comparator)() const) {
                 std::swap(vec[j], vec[j+1]);
 }
 
+// Collects report text in a buffer and hands it to the sink only when the buffer fills up or on
+// flush(), instead of flushing every line like std::endl does. The default buffer suits a single
+// record; a whole term report asks for a larger one.
+class ReportWriter {
+    std::string buffer;
+    std::function<void(const char*, size_t)> sink;
+    size_t capacity;
+
+public:
+    static void toStdout(const char* data, size_t size) {
+        fwrite(data, 1, size, stdout);
+    }
+    explicit ReportWriter(std::function<void(const char*, size_t)> sink = toStdout, size_t capacity = 1 << 12)
+            : sink(std::move(sink)), capacity(capacity) {
+        buffer.reserve(capacity);
+    }
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+    ~ReportWriter() {
+        flush();
+    }
+    ReportWriter& write(const char* data, size_t size) {
+        if (buffer.size() + size > capacity)
+            flush();
+        buffer.append(data, size);
+        return *this;
+    }
+    ReportWriter& operator<<(const char* str) {
+        return write(str, std::strlen(str));
+    }
+    ReportWriter& operator<<(const std::string& str) {
+        return write(str.data(), str.size());
+    }
+    ReportWriter& operator<<(char c) {
+        return write(&c, 1);
+    }
+    ReportWriter& operator<<(int value) {
+        char digits[11];
+        return write(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr - digits);
+    }
+    const std::string& str() const {
+        return buffer;
+    }
+    void flush() {
+        if (!buffer.empty() && sink)
+            sink(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+};
+
 class Time {
     int min;
     int hour;
@@ -196,30 +292,30 @@ Day operator++(Day& day) {
     day = static_cast<Day>((static_cast<int>(day) + 1) % 7);
     return day;
 }
+const char* const DAY_NAMES[] = {"Saturday", "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday"};
+const unsigned char DAY_NAME_LENGTHS[] = {8, 6, 6, 7, 9, 8, 6};
+
+const char* dayName(const Day& day) {
+    return DAY_NAMES[static_cast<int>(day)];
+}
+// The format* helpers write into a caller buffer without a terminating NUL and return the end, like std::to_chars
+char* formatText(char* out, const char* text, size_t length) {
+    std::memcpy(out, text, length);
+    return out + length;
+}
+// writes nothing past end; the callers' buffers are sized for the longest int
+char* formatInt(char* out, char* end, int value) {
+    return std::to_chars(out, end, value).ptr;
+}
+// needs 9 bytes
+char* formatDay(char* out, const Day& day) {
+    return formatText(out, dayName(day), DAY_NAME_LENGTHS[static_cast<int>(day)]);
+}
 std::ostream& operator<<(std::ostream& os, const Day& day) {
-    switch (day) {
-        case Day::sat: os << "Saturday"; break;
-        case Day::sun: os << "Sunday"; break;
-        case Day::mon: os << "Monday"; break;
-        case Day::tue: os << "Tuesday"; break;
-        case Day::wed: os << "Wednesday"; break;
-        case Day::thu: os << "Thursday"; break;
-        case Day::fri: os << "Friday"; break;
-    }
-    return os;
+    return os << dayName(day);
 }
 std::string dayToStr(const Day& day) {
-    std::string str;
-    switch(day) {
-        case Day::sat: str = "Saturday"; break;
-        case Day::sun: str = "Sunday"; break;
-        case Day::mon: str = "Monday"; break;
-        case Day::tue: str = "Tuesday"; break;
-        case Day::wed: str = "Wednesday"; break;
-        case Day::thu: str = "Thursday"; break;
-        case Day::fri: str = "Friday"; break;
-    }
-    return  str;
+    return std::string(dayName(day), DAY_NAME_LENGTHS[static_cast<int>(day)]);
 }
 std::string operator+(const std::string& str, const Day& day) {
     return str + dayToStr(day);
@@ -228,6 +324,18 @@ std::string operator+(const Day& day, const std::string& str) {
     return dayToStr(day) + str;
 }
 
+const char* range_error::what() const noexcept {
+    if (message.empty()) {
+        char buffer[64];
+        char* const end = buffer + sizeof(buffer);
+        char* out = formatInt(formatText(buffer, "Out of range error: Range: [", 28), end, minValue);
+        out = formatInt(formatText(out, " - ", 3), end, maxValue);
+        *out++ = ']';
+        message.assign(buffer, out);
+    }
+    return message.c_str();
+}
+
 class Date {
 private:
     int day, month, year;
@@ -258,8 +366,31 @@ public:
     bool operator>=(const Date& other) const {
         return !(*this < other);
     }
+    int getDay() const {
+        return day;
+    }
+    int getMonth() const {
+        return month;
+    }
+    int getYear() const {
+        return year;
+    }
+    // yyyymmdd, ordered the same way as operator<
+    int toOrdinal() const {
+        return year * 10000 + month * 100 + day;
+    }
+    static constexpr size_t FORMAT_SIZE = 35;
+    // yyyy/m/d, needs FORMAT_SIZE bytes
+    char* format(char* out, char* end) const {
+        out = formatInt(out, end, year);
+        *out++ = '/';
+        out = formatInt(out, end, month);
+        *out++ = '/';
+        return formatInt(out, end, day);
+    }
     std::string dateToString() const {
-        return std::to_string(year) + "/" + std::to_string(month) + "/" + std::to_string(day);
+        char buffer[FORMAT_SIZE];
+        return std::string(buffer, format(buffer, buffer + FORMAT_SIZE));
     }
 };
 
@@ -269,6 +400,18 @@ class WeekTime {
 
 public:
     WeekTime(Day day, const Time &time) : day(day), time(time) {}
+    Day getDay() const {
+        return day;
+    }
+    const Time &getTime() const {
+        return time;
+    }
+    int minuteOfWeek() const {
+        return (static_cast<int>(day) * 24 + time.getHour()) * 60 + time.getMin();
+    }
+    static WeekTime fromMinuteOfWeek(int minute) {
+        return WeekTime(static_cast<Day>(minute / (24 * 60)), Time(minute / 60 % 24, minute % 60));
+    }
     WeekTime endTime(int durationMinutes) const {
         WeekTime wt(day, time.after(durationMinutes - 1));
         return wt;
@@ -308,12 +451,60 @@ public:
     bool operator==(const WeekTime& other) const {
         return (day == other.day && time == other.time);
     }
+    static constexpr size_t FORMAT_SIZE = 15;
+    // "Wednesday 9:05", needs FORMAT_SIZE bytes
+    char* format(char* out, char* end) const {
+        out = formatDay(out, day);
+        *out++ = ' ';
+        out = formatInt(out, end, time.getHour());
+        *out++ = ':';
+        *out++ = static_cast<char>('0' + time.getMin() / 10);
+        *out++ = static_cast<char>('0' + time.getMin() % 10);
+        return out;
+    }
     std::string weekTimeToString() const {
-        return day + " " + std::to_string(time.getHour()) + ":" + (time.getMin() < 10 ? "0" : "") + std::to_string(time.getMin() );
+        char buffer[FORMAT_SIZE];
+        return std::string(buffer, format(buffer, buffer + FORMAT_SIZE));
     }
 
 };
 
+static char* formatConflictWith(char* out, char* end, bool selfLesson, int lessonId, int classroom) {
+    if (selfLesson)
+        return formatText(out, "self lesson", 11);
+    if (lessonId != -1)
+        out = formatInt(out, end, lessonId);
+    if (classroom != -1)
+        out = formatInt(formatText(out, " at the class number", 20), end, classroom);
+    return out;
+}
+const char* conflict_error::what() const noexcept {
+    if (message.empty()) {
+        char buffer[96];
+        char* const end = buffer + sizeof(buffer);
+        char* out = formatText(buffer, "Conflict Error with: ", 21);
+        out = formatConflictWith(out, end, selfLesson, lessonId, classroom);
+        out = WeekTime::fromMinuteOfWeek(at).format(formatText(out, " at ", 4), end);
+        message.assign(buffer, out);
+    }
+    return message.c_str();
+}
+std::string conflict_error::getWith() const {
+    char buffer[48];
+    return std::string(buffer, formatConflictWith(buffer, buffer + sizeof(buffer), selfLesson, lessonId, classroom));
+}
+std::string conflict_error::getAt() const {
+    return WeekTime::fromMinuteOfWeek(at).weekTimeToString();
+}
+ReportWriter& operator<<(ReportWriter& out, const WeekTime& wt) {
+    char buffer[WeekTime::FORMAT_SIZE];
+    return out.write(buffer, wt.format(buffer, buffer + sizeof(buffer)) - buffer);
+}
+ReportWriter& operator<<(ReportWriter& out, const Date& date) {
+    char buffer[Date::FORMAT_SIZE];
+    return out.write(buffer, date.format(buffer, buffer + sizeof(buffer)) - buffer);
+}
+
 class Person {
     std::string name;
     int id;
@@ -336,8 +527,12 @@ public:
     bool isTeacher() const {
         return is_teacher;
     }
+    void renderPerson(ReportWriter& out) const {
+        out << "ID: " << id << '\t' << "Name: " << name << '\n';
+    }
     void printPerson() const {
-        std::cout << "ID: " << id << "\t" << "Name: " << name << std::endl;
+        ReportWriter out;
+        renderPerson(out);
     }
 };
 
@@ -346,20 +541,20 @@ class PersonList {
     std::vector<Person> teacherList;
 
 public:
-    void addPerson (const Person& new_person) {
+    bool addPerson (const Person& new_person) {
         try {
-            for (const auto& person: personList)
-                if (person.getId() == new_person.getId())
-                    throw "Duplicate ID";
-            personList.push_back(new_person);
-            sort(personList, &Person::getId);
-            if (new_person.isTeacher()) {
-                teacherList.push_back(new_person);
-                sort(teacherList, &Person::getId);
-            }
+            auto byId = [](const Person& p, int id) { return p.getId() < id; };
+            auto it = std::lower_bound(personList.begin(), personList.end(), new_person.getId(), byId);
+            if (it != personList.end() && it->getId() == new_person.getId())
+                throw "Duplicate ID";
+            personList.insert(it, new_person);
+            if (new_person.isTeacher())
+                teacherList.insert(std::lower_bound(teacherList.begin(), teacherList.end(), new_person.getId(), byId), new_person);
+            return true;
         }
         catch (char const* s) {
             std::cout << s << std::endl;
+            return false;
         }
         catch (std::exception& e) {
             throw;
@@ -371,6 +566,12 @@ public:
         else
             throw "Couldn't Find Such a Person!";
     }
+    const Person& findPerson(int personID) const {
+        if (int index = binarySearch(personList, &Person::getId, personID); index != -1)
+            return personList[index];
+        else
+            throw "Couldn't Find Such a Person!";
+    }
     Person getTeacherInfo(int teacherID) const {
         return teacherList.at(binarySearch(personList, &Person::getId, teacherID));
     }
@@ -394,9 +595,45 @@ public:
     }
 };
 
+using FeatureMask = uint32_t;
+
+// Classroom feature names of one ClassroomList. A name gets its own bit of a FeatureMask the first
+// time a room of the list has it, the projector always being bit 0, so a room meets a requirement
+// when (room & required) == required. Lessons require features by name, as they exist before a term.
+class Features {
+    std::vector<std::string> names{"projector"};
+
+public:
+    static constexpr FeatureMask PROJECTOR = 1;
+    // no room has this bit, so a lesson requiring a feature no room has fits nowhere
+    static constexpr FeatureMask MISSING = FeatureMask(1) << 31;
+    static constexpr size_t MAX_FEATURES = 31;
+
+    FeatureMask bit(const std::string& name) {
+        for (size_t i = 0; i < names.size(); i++)
+            if (names[i] == name)
+                return FeatureMask(1) << i;
+        if (names.size() == MAX_FEATURES)
+            throw "Too Many Classroom Features!";
+        names.push_back(name);
+        return FeatureMask(1) << (names.size() - 1);
+    }
+    FeatureMask mask(const std::set<std::string>& required) const {
+        FeatureMask mask = 0;
+        for (const auto& name: required) {
+            auto it = std::find(names.begin(), names.end(), name);
+            mask |= it == names.end() ? MISSING : FeatureMask(1) << (it - names.begin());
+        }
+        return mask;
+    }
+    const std::vector<std::string>& list() const {
+        return names;
+    }
+};
+
 class Classroom {
     int number;
-    bool projector;
+    FeatureMask features;
     int capacity;
 
 public:
@@ -417,13 +654,22 @@ public:
         } catch (const range_error& e) {
             throw;
         }
-        this->projector = projector;
+        this->features = projector ? Features::PROJECTOR : 0;
     }
     int getNumber() const {
         return number;
     }
     bool isProjector() const {
-        return projector;
+        return features & Features::PROJECTOR;
+    }
+    FeatureMask getFeatures() const {
+        return features;
+    }
+    void setFeatures(FeatureMask mask) {
+        features = mask;
+    }
+    bool hasFeatures(FeatureMask required) const {
+        return (features & required) == required;
     }
     int getCapacity() const {
         return capacity;
@@ -434,42 +680,119 @@ public:
     bool operator!=(const Classroom &rhs) const {
         return number != rhs.number;
     }
+    void renderClassroomSpecs(ReportWriter& out) const {
+        out << "Classroom Number: " << number << '\n';
+        out << "Has Projector: " << (isProjector() ? "Yes" : "No") << '\n';
+        out << "Capacity: " << capacity << " students" << '\n';
+    }
     void printClassroomSpecs() const {
-        std::cout << "Classroom Number: " << number << std::endl;
-        std::cout << "Has Projector: " << (projector ? "Yes" : "No") << std::endl;
-        std::cout << "Capacity: " << capacity << " students" << std::endl;
+        ReportWriter out;
+        renderClassroomSpecs(out);
     }
 };
 
 class ClassroomList {
     std::vector<Classroom> list;
+    Features featureNames;
+    // capacities and features of list, laid out flat so filtering all rooms is one vectorizable loop
+    std::vector<int> capacities;
+    std::vector<FeatureMask> features;
+
+    void index() {
+        capacities.resize(list.size());
+        features.resize(list.size());
+        for (size_t i = 0; i < list.size(); i++) {
+            capacities[i] = list[i].getCapacity();
+            features[i] = list[i].getFeatures();
+        }
+    }
     int readFile() {
+        // only attributes are read, so the file is parsed as SAX events without a DOM
+        struct Reader : tinyxml2::XMLSaxHandler {
+            std::vector<Classroom> rooms;
+            Features names;
+            int depth = 0;
+            enum { BEFORE, INSIDE, AFTER } root = BEFORE;
+            bool StartElement(const char* name, const tinyxml2::XMLSaxAttributes& attributes) override {
+                if (depth == 0 && root == BEFORE && std::strcmp(name, "classrooms") == 0)
+                    root = INSIDE;
+                else if (depth == 1 && root == INSIDE && std::strcmp(name, "classroom") == 0)
+                    rooms.push_back(fromAttributes(attributes, names));
+                depth++;
+                return true;
+            }
+            bool EndElement(const char*) override {
+                if (--depth == 0 && root == INSIDE)
+                    root = AFTER;
+                return true;
+            }
+        };
+        Reader reader;
         tinyxml2::XMLDocument doc;
+        doc.SetSaxHandler(&reader);
         if (doc.LoadFile("class.xml") != tinyxml2::XML_SUCCESS) {
             std::cout << "Error loading XML file." << std::endl;
             return 1;
         }
-        tinyxml2::XMLElement* root = doc.FirstChildElement("classrooms");
-        if (root) {
-            for (tinyxml2::XMLElement* elem = root->FirstChildElement("classroom"); elem; elem = elem->NextSiblingElement("classroom")) {
-                int num, cap;
-                bool proj;
-                elem->QueryIntAttribute("number", &num);
-                elem->QueryIntAttribute("capacity", &cap);
-                proj = elem->BoolAttribute("projector");
-                list.emplace_back(num, cap, proj);
-            }
-        } else {
+        if (reader.root == Reader::BEFORE) {
             std::cerr << "Error finding root element in XML file." << std::endl;
             return 1;
         }
+        list.insert(list.end(), reader.rooms.begin(), reader.rooms.end());
+        featureNames = reader.names;
         return 0;
     }
 
 public:
-    explicit ClassroomList(const std::vector<Classroom> &list) : list(list) {}
+    explicit ClassroomList(const std::vector<Classroom> &list) : list(list) {
+        index();
+    }
+    // rooms whose feature masks are in terms of names
+    ClassroomList(const std::vector<Classroom> &list, const Features& names) : list(list), featureNames(names) {
+        index();
+    }
     explicit ClassroomList() {
         readFile();
+        index();
+    }
+    // number and capacity, plus every other attribute whose value is "true" as a feature added to names;
+    // other values, numbers included, are plain attributes
+    static Classroom fromElement(const tinyxml2::XMLElement* elem, Features& names) {
+        int num = 0, cap = 0;
+        elem->QueryIntAttribute("number", &num);
+        elem->QueryIntAttribute("capacity", &cap);
+        Classroom classroom(num, cap, false);
+        FeatureMask mask = 0;
+        for (const tinyxml2::XMLAttribute* attr = elem->FirstAttribute(); attr; attr = attr->Next())
+            if (isFeature(attr->Name(), attr->Value()))
+                mask |= names.bit(attr->Name());
+        classroom.setFeatures(mask);
+        return classroom;
+    }
+    // the same from the attributes of a <classroom> read by a SAX handler
+    static Classroom fromAttributes(const tinyxml2::XMLSaxAttributes& attributes, Features& names) {
+        Classroom classroom(attributes.IntAttribute("number"), attributes.IntAttribute("capacity"), false);
+        FeatureMask mask = 0;
+        for (int i = 0; i < attributes.Count(); i++)
+            if (isFeature(attributes.Name(i), attributes.Value(i)))
+                mask |= names.bit(attributes.Name(i));
+        classroom.setFeatures(mask);
+        return classroom;
+    }
+    static bool isFeature(const char* name, const char* value) {
+        return std::strcmp(name, "number") != 0 && std::strcmp(name, "capacity") != 0 && std::strcmp(value, "true") == 0;
+    }
+    const Features& getFeatures() const {
+        return featureNames;
+    }
+    // eligible[i] is set when room i has at least minCapacity seats and all the required features
+    void filter(int minCapacity, FeatureMask required, std::vector<unsigned char>& eligible) const {
+        eligible.resize(list.size());
+        const int* cap = capacities.data();
+        const FeatureMask* feat = features.data();
+        unsigned char* out = eligible.data();
+        for (size_t i = 0, n = list.size(); i < n; i++)
+            out[i] = (cap[i] >= minCapacity) & ((feat[i] & required) == required);
     }
     ~ClassroomList() {
     }
@@ -484,6 +807,7 @@ public:
             }
         }
         list = filtered;
+        index();
     }
     bool isEmpty() const {
         return list.empty();
@@ -499,10 +823,14 @@ public:
     }
     void removeMinCapacityClassroom() {
         list.erase(minCapacity());
+        index();
     }
     Classroom getClassroomInfo(int classroomNumber) const {
         return list.at(binarySearch(list, &Classroom::getNumber,classroomNumber));
     }
+    const Classroom& findClassroom(int classroomNumber) const {
+        return list.at(binarySearch(list, &Classroom::getNumber,classroomNumber));
+    }
 };
 
 
@@ -512,33 +840,43 @@ protected:
     std::string name;
     std::map<WeekTime, int> session;
     int lesson_max_capacity;
-    bool projector;
+    std::set<std::string> required_features;
 public:
-    Lesson(int id, std::string name, int capacity, bool projector = false) : id(id), name(std::move(name)), lesson_max_capacity(capacity), projector(projector) {}
+    Lesson(int id, std::string name, int capacity, bool projector = false)
+            : id(id), name(std::move(name)), lesson_max_capacity(capacity) {
+        if (projector)
+            required_features.insert("projector");
+    }
     virtual void conflictSessionTime(const WeekTime& new_wt, int durationMin) const {
         for (auto this_session : session)
             if (!(new_wt.endTime(durationMin) <= this_session.first || new_wt >= this_session.first.endTime(this_session.second)))
-                throw conflict_error(this_session.first.weekTimeToString());
+                throw conflict_error(this_session.first.minuteOfWeek(), -1, id);
     }
-    void addSession (const WeekTime& new_wt, int durationMin) {
+    void checkNewSession(const WeekTime& new_wt, int durationMin) const {
         if (durationMin > MAX_SESSION_DURATION_MINUTES || durationMin < 1)
             throw range_error(1, MAX_SESSION_DURATION_MINUTES);
         try {
             conflictSessionTime(new_wt, durationMin);
         }
         catch (conflict_error& e) {
-            e.setWith("self lesson");
+            e.setSelfLesson();
             throw;
         }
+    }
+    void addSession (const WeekTime& new_wt, int durationMin) {
+        checkNewSession(new_wt, durationMin);
         session.insert(std::pair(new_wt, durationMin));
     }
+    void removeSession(const WeekTime& wt) {
+        session.erase(wt);
+    }
     virtual void conflictLessonTime(const Lesson& lesson) const {
         try {
             for (auto temp_session: lesson.getSession())
                 conflictSessionTime(temp_session.first, temp_session.second);
         }
         catch (conflict_error& e) {
-            e.setWith(std::to_string(lesson.getId()));
+            e.setLessonId(lesson.getId());
             throw;
         }
     }
@@ -561,7 +899,16 @@ public:
         return lesson_max_capacity;
     }
     bool getNeedProjector() const {
-        return projector;
+        return required_features.count("projector") != 0;
+    }
+    const std::set<std::string>& getRequiredFeatures() const {
+        return required_features;
+    }
+    void setRequiredFeatures(const std::set<std::string>& features) {
+        required_features = features;
+    }
+    void requireFeature(const std::string& feature) {
+        required_features.insert(feature);
     }
     bool operator<(const Lesson& rhs) const {
         return id < rhs.id;
@@ -572,21 +919,25 @@ public:
     bool operator!=(const Lesson& other) const {
         return id != other.id;
     }
-    virtual void printLesson() const {
-        std::cout << "Lesson ID: " << id << std::endl;
-        std::cout << "Lesson Name: " << name << std::endl;
-        std::cout << "Max Capacity: " << lesson_max_capacity << std::endl;
-        std::cout << "Requires Projector: " << (projector ? "Yes" : "No") << std::endl;
-        std::cout << "Session Details:\n  ----------" << std::endl;
+    virtual void renderLesson(ReportWriter& out) const {
+        out << "Lesson ID: " << id << '\n';
+        out << "Lesson Name: " << name << '\n';
+        out << "Max Capacity: " << lesson_max_capacity << '\n';
+        out << "Requires Projector: " << (getNeedProjector() ? "Yes" : "No") << '\n';
+        out << "Session Details:\n  ----------" << '\n';
         for (const auto &sessionEntry: session) {
             const WeekTime &wt = sessionEntry.first;
             int duration = sessionEntry.second;
-            std::cout << "  Start Time: " << wt.weekTimeToString() << std::endl;
-            std::cout << "  Duration: " << duration << " minutes" << std::endl;
-            std::cout << "  End Time: " << wt.endTime(duration).weekTimeToString() << std::endl;
-            std::cout << "  ----------" << std:: endl;
+            out << "  Start Time: " << wt << '\n';
+            out << "  Duration: " << duration << " minutes" << '\n';
+            out << "  End Time: " << wt.endTime(duration) << '\n';
+            out << "  ----------" << '\n';
         }
     }
+    void printLesson() const {
+        ReportWriter out;
+        renderLesson(out);
+    }
 };
 
 class ExtraLesson : public Lesson {
@@ -606,15 +957,15 @@ public:
                 conflictSessionTime(temp_session.first, temp_session.second);
         }
         catch (conflict_error& e) {
-            e.setWith(std::to_string(lesson.getId()));
+            e.setLessonId(lesson.getId());
             throw;
         }
     }
-    void printLesson() const override  {
-        Lesson::printLesson();
-        std::cout << "  Start Date: " << start.dateToString() << std::endl;
-        std::cout << "  End Date: " << end.dateToString() << std::endl;
-        std::cout << "  ----------" << std::endl;
+    void renderLesson(ReportWriter& out) const override {
+        Lesson::renderLesson(out);
+        out << "  Start Date: " << start << '\n';
+        out << "  End Date: " << end << '\n';
+        out << "  ----------" << '\n';
     }
 
     const Date &getStart() const {
@@ -626,25 +977,1329 @@ public:
 };
 
 
+// One booked session on a timeline. begin and last are minutes since Saturday 00:00, last being
+// the inclusive end minute of WeekTime::endTime, so two slots conflict exactly when
+// Lesson::conflictSessionTime would report them. Extra lessons carry their date range.
+struct TimeSlot {
+    int begin;
+    int last;
+    int lessonId;
+    int from = 0;
+    int to = 0;
+
+    static TimeSlot of(const WeekTime& wt, int durationMin, int lessonId = -1) {
+        return TimeSlot{wt.minuteOfWeek(), wt.endTime(durationMin).minuteOfWeek(), lessonId};
+    }
+    bool overlaps(const TimeSlot& other) const {
+        if (last <= other.begin || begin >= other.last)
+            return false;
+        // two extra lessons held on disjoint dates never meet, as in ExtraLesson::conflictLessonTime
+        if (from && other.from && (from >= other.to || to <= other.from))
+            return false;
+        return true;
+    }
+    bool operator<(const TimeSlot& other) const {
+        return begin != other.begin ? begin < other.begin : lessonId < other.lessonId;
+    }
+    bool operator==(const TimeSlot& other) const {
+        return begin == other.begin && lessonId == other.lessonId;
+    }
+};
+
+// Booked sessions of one classroom or person ordered by start minute. No session is longer than
+// MAX_SESSION_DURATION_MINUTES, so overlap lookups only scan the slots starting in that window.
+class Timeline {
+    std::set<TimeSlot> slots;
+
+public:
+    void add(const TimeSlot& slot) {
+        slots.insert(slot);
+    }
+    void remove(const TimeSlot& slot) {
+        slots.erase(slot);
+    }
+    const TimeSlot* findConflict(const TimeSlot& probe) const {
+        auto it = slots.lower_bound(TimeSlot{probe.begin - MAX_SESSION_DURATION_MINUTES, 0, INT32_MIN});
+        for (; it != slots.end() && it->begin < probe.last; ++it)
+            if (it->lessonId != probe.lessonId && it->overlaps(probe))
+                return &*it;
+        return nullptr;
+    }
+    template<typename F>
+    void forEachConflict(const TimeSlot& probe, F f) const {
+        auto it = slots.lower_bound(TimeSlot{probe.begin - MAX_SESSION_DURATION_MINUTES, 0, INT32_MIN});
+        for (; it != slots.end() && it->begin < probe.last; ++it)
+            if (it->lessonId != probe.lessonId && it->overlaps(probe))
+                f(*it);
+    }
+    bool isFree(const TimeSlot& probe) const {
+        return findConflict(probe) == nullptr;
+    }
+    const std::set<TimeSlot>& getSlots() const {
+        return slots;
+    }
+    bool empty() const {
+        return slots.empty();
+    }
+};
+
+struct TimetableEntry {
+    TimeSlot slot;
+    int classroom;
+};
+
+// Weekly timetable of one person sorted by start minute. LessonList keeps it up to date on every
+// assignment, so "my schedule" is served as is and person conflicts are probed without touching lessons.
+class Timetable {
+    std::vector<TimetableEntry> entries;
+
+    static bool startsBefore(const TimetableEntry& entry, const TimeSlot& slot) {
+        return entry.slot < slot;
+    }
+
+public:
+    void add(const TimeSlot& slot, int classroom) {
+        entries.insert(std::lower_bound(entries.begin(), entries.end(), slot, startsBefore), TimetableEntry{slot, classroom});
+    }
+    void remove(const TimeSlot& slot) {
+        auto it = std::lower_bound(entries.begin(), entries.end(), slot, startsBefore);
+        if (it != entries.end() && it->slot == slot)
+            entries.erase(it);
+    }
+    void setClassroom(int lessonId, int classroom) {
+        for (auto& e: entries)
+            if (e.slot.lessonId == lessonId)
+                e.classroom = classroom;
+    }
+    const TimeSlot* findConflict(const TimeSlot& probe) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), TimeSlot{probe.begin - MAX_SESSION_DURATION_MINUTES, 0, INT32_MIN}, startsBefore);
+        for (; it != entries.end() && it->slot.begin < probe.last; ++it)
+            if (it->slot.overlaps(probe))
+                return &it->slot;
+        return nullptr;
+    }
+    const std::vector<TimetableEntry>& getEntries() const {
+        return entries;
+    }
+    bool empty() const {
+        return entries.empty();
+    }
+};
+
+// Students waiting for a seat in one lesson: higher priority first, first come first served within
+// a priority. Cancelled entries are skipped lazily when they reach the front, so push, pop and
+// remove are all O(1) amortized.
+class Waitlist {
+    std::map<int, std::deque<std::pair<int, unsigned>>, std::greater<int>> queues;
+    std::unordered_map<int, unsigned> tickets;
+    unsigned nextTicket = 0;
+
+public:
+    bool push(int studentId, int priority = 0) {
+        if (!tickets.emplace(studentId, nextTicket).second)
+            return false;
+        queues[priority].emplace_back(studentId, nextTicket++);
+        return true;
+    }
+    bool remove(int studentId) {
+        return tickets.erase(studentId) != 0;
+    }
+    bool contains(int studentId) const {
+        return tickets.count(studentId) != 0;
+    }
+    // returns -1 when nobody is waiting
+    int pop() {
+        while (!queues.empty()) {
+            auto& front = queues.begin()->second;
+            while (!front.empty()) {
+                auto entry = front.front();
+                front.pop_front();
+                auto it = tickets.find(entry.first);
+                if (it != tickets.end() && it->second == entry.second) {
+                    tickets.erase(it);
+                    return entry.first;
+                }
+            }
+            queues.erase(queues.begin());
+        }
+        return -1;
+    }
+    size_t size() const {
+        return tickets.size();
+    }
+    bool empty() const {
+        return tickets.empty();
+    }
+};
+
+// Simulated annealing over the classroom assignment of a term, minimizing wasted seat-minutes
+// (room capacity above the lesson capacity, times the lesson's weekly minutes). A step either moves
+// one lesson to a free room or swaps the rooms of two lessons, always keeping capacity, feature
+// and time conflict rules. Every thread runs its own chain from the current assignment with seed + chain
+// number; the best chain wins, so for a fixed iteration count the result does not depend on timing.
+// The time budget only cuts chains short.
+class ClassroomOptimizer {
+public:
+    struct Room {
+        int number;
+        int capacity;
+        FeatureMask features;
+    };
+    struct Item {
+        int lessonId;
+        int capacity;
+        FeatureMask required;
+        int minutes;
+        std::vector<TimeSlot> slots;
+        int room;
+    };
+    struct Options {
+        unsigned threads = 1;
+        uint64_t seed = 1;
+        long iterations = 200000;
+        std::chrono::milliseconds budget{1000};
+    };
+
+private:
+    std::vector<Room> rooms;
+    std::vector<Item> items;
+    std::unordered_map<int, int> itemOfLesson;
+    int maxCapacity = 0;
+
+    struct Chain {
+        std::vector<int> assign;
+        std::vector<Timeline> timelines;
+        long long cost;
+        std::vector<int> best;
+        long long bestCost;
+    };
+
+    bool fits(const Item& item, int room) const {
+        return rooms[room].capacity >= item.capacity && (rooms[room].features & item.required) == item.required;
+    }
+    long long itemCost(const Item& item, int room) const {
+        if (room == -1)
+            return static_cast<long long>(maxCapacity + 1) * item.minutes;
+        return static_cast<long long>(rooms[room].capacity - item.capacity) * item.minutes;
+    }
+    // lessons booked in the room that clash with the item, other than itself and ignore
+    void conflicts(const Chain& chain, const Item& item, int room, int ignore, std::vector<int>& out) const {
+        out.clear();
+        for (const auto& slot: item.slots)
+            chain.timelines[room].forEachConflict(slot, [&out, ignore](const TimeSlot& other) {
+                if (other.lessonId != ignore && std::find(out.begin(), out.end(), other.lessonId) == out.end())
+                    out.push_back(other.lessonId);
+            });
+    }
+    void place(Chain& chain, int i, int room) const {
+        if (chain.assign[i] != -1)
+            for (const auto& slot: items[i].slots)
+                chain.timelines[chain.assign[i]].remove(slot);
+        chain.assign[i] = room;
+        for (const auto& slot: items[i].slots)
+            chain.timelines[room].add(slot);
+    }
+    void anneal(Chain& chain, uint64_t seed, const Options& options, std::chrono::steady_clock::time_point deadline) const {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        const double startTemperature = 40.0 * 60, endTemperature = 0.5;
+        std::vector<int> clash, back;
+        for (long step = 0; step < options.iterations; step++) {
+            if ((step & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+                break;
+            double temperature = startTemperature * std::pow(endTemperature / startTemperature, static_cast<double>(step) / options.iterations);
+            int i = static_cast<int>(rng() % items.size());
+            int room = static_cast<int>(rng() % rooms.size());
+            int current = chain.assign[i];
+            if (room == current || !fits(items[i], room))
+                continue;
+            conflicts(chain, items[i], room, items[i].lessonId, clash);
+            long long delta;
+            int j = -1;
+            if (clash.empty())
+                delta = itemCost(items[i], room) - itemCost(items[i], current);
+            else if (clash.size() == 1 && current != -1) {
+                j = itemOfLesson.at(clash.front());
+                if (!fits(items[j], current))
+                    continue;
+                conflicts(chain, items[j], current, items[i].lessonId, back);
+                if (!back.empty())
+                    continue;
+                delta = itemCost(items[i], room) + itemCost(items[j], current) - itemCost(items[i], current) - itemCost(items[j], room);
+            }
+            else
+                continue;
+            if (delta > 0 && unit(rng) >= std::exp(-static_cast<double>(delta) / temperature))
+                continue;
+            if (j != -1) {
+                for (const auto& slot: items[j].slots)
+                    chain.timelines[room].remove(slot);
+                place(chain, i, room);
+                chain.assign[j] = current;
+                for (const auto& slot: items[j].slots)
+                    chain.timelines[current].add(slot);
+            }
+            else
+                place(chain, i, room);
+            chain.cost += delta;
+            if (chain.cost < chain.bestCost) {
+                chain.bestCost = chain.cost;
+                chain.best = chain.assign;
+            }
+        }
+    }
+
+public:
+    ClassroomOptimizer(std::vector<Room> rooms, std::vector<Item> items) : rooms(std::move(rooms)), items(std::move(items)) {
+        for (size_t i = 0; i < this->items.size(); i++)
+            itemOfLesson[this->items[i].lessonId] = static_cast<int>(i);
+        for (const auto& room: this->rooms)
+            maxCapacity = std::max(maxCapacity, room.capacity);
+    }
+    long long cost(const std::vector<int>& assign) const {
+        long long total = 0;
+        for (size_t i = 0; i < items.size(); i++)
+            total += itemCost(items[i], assign[i]);
+        return total;
+    }
+    // best room index for every item, -1 where it stays without a room
+    std::vector<int> run(const Options& options) const {
+        Chain initial;
+        initial.timelines.resize(rooms.size());
+        for (const auto& item: items) {
+            initial.assign.push_back(item.room);
+            if (item.room != -1)
+                for (const auto& slot: item.slots)
+                    initial.timelines[item.room].add(slot);
+        }
+        initial.cost = initial.bestCost = cost(initial.assign);
+        initial.best = initial.assign;
+        if (items.empty() || rooms.empty())
+            return initial.best;
+        auto deadline = std::chrono::steady_clock::now() + options.budget;
+        std::vector<Chain> chains(std::max(1u, options.threads), initial);
+        std::vector<std::thread> pool;
+        for (size_t c = 0; c < chains.size(); c++)
+            pool.emplace_back([this, &chains, c, &options, deadline]() { anneal(chains[c], options.seed + c, options, deadline); });
+        for (auto& t: pool)
+            t.join();
+        const Chain* best = &chains.front();
+        for (const auto& chain: chains)
+            if (chain.bestCost < best->bestCost)
+                best = &chain;
+        return best->best;
+    }
+};
+
+struct ClassroomStats {
+    int number;
+    int capacity;
+    bool projector;
+    int bookedMinutes;
+    int availableMinutes;
+    // bookedMinutes / availableMinutes
+    double utilization;
+    // enrolled seat-minutes / capacity seat-minutes over the booked sessions
+    double seatEfficiency;
+    // minutes a projector room is booked by lessons that do not need a projector
+    int projectorMinutesWithoutNeed;
+};
+
+struct TermStats {
+    std::vector<ClassroomStats> classrooms;
+    std::map<int, double> teacherWeeklyHours;
+    int bookedMinutes = 0;
+    int availableMinutes = 0;
+    int projectorMinutesWithoutNeed = 0;
+};
+
+class ByteWriter {
+    std::string buffer;
+
+public:
+    void putU8(uint8_t v) {
+        buffer.push_back(static_cast<char>(v));
+    }
+    void putU32(uint32_t v) {
+        for (int i = 0; i < 4; i++)
+            buffer.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    void putI32(int v) {
+        putU32(static_cast<uint32_t>(v));
+    }
+    void putStr(const std::string& str) {
+        putU32(static_cast<uint32_t>(str.size()));
+        buffer.append(str);
+    }
+    void putDate(const Date& date) {
+        putI32(date.getDay());
+        putI32(date.getMonth());
+        putI32(date.getYear());
+    }
+    void putWeekTime(const WeekTime& wt) {
+        putU8(static_cast<uint8_t>(wt.getDay()));
+        putU8(static_cast<uint8_t>(wt.getTime().getHour()));
+        putU8(static_cast<uint8_t>(wt.getTime().getMin()));
+    }
+    void putPerson(const Person& person) {
+        putStr(person.getName());
+        putI32(person.getId());
+        putU8(person.isTeacher());
+    }
+    void putFeatures(const std::set<std::string>& features) {
+        putU8(static_cast<uint8_t>(features.size()));
+        for (const auto& name: features)
+            putStr(name);
+    }
+    void putLesson(const Lesson& lesson) {
+        putI32(lesson.getId());
+        putStr(lesson.getName());
+        putI32(lesson.getLessonMaxCapacity());
+        putFeatures(lesson.getRequiredFeatures());
+        putU32(static_cast<uint32_t>(lesson.getSession().size()));
+        for (const auto& s: lesson.getSession()) {
+            putWeekTime(s.first);
+            putI32(s.second);
+        }
+    }
+    const std::string& data() const {
+        return buffer;
+    }
+    void clear() {
+        buffer.clear();
+    }
+};
+
+class ByteReader {
+    const char* pos;
+    const char* end;
+
+    void need(size_t n) const {
+        if (static_cast<size_t>(end - pos) < n)
+            throw "Truncated record!";
+    }
+
+public:
+    ByteReader(const char* data, size_t size) : pos(data), end(data + size) {}
+    uint8_t getU8() {
+        need(1);
+        return static_cast<uint8_t>(*pos++);
+    }
+    uint32_t getU32() {
+        need(4);
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++)
+            v |= static_cast<uint32_t>(static_cast<uint8_t>(pos[i])) << (8 * i);
+        pos += 4;
+        return v;
+    }
+    int getI32() {
+        return static_cast<int>(getU32());
+    }
+    std::string getStr() {
+        uint32_t size = getU32();
+        need(size);
+        std::string str(pos, size);
+        pos += size;
+        return str;
+    }
+    Date getDate() {
+        int d = getI32();
+        int m = getI32();
+        int y = getI32();
+        return Date(d, m, y);
+    }
+    WeekTime getWeekTime() {
+        auto day = static_cast<Day>(getU8());
+        int hour = getU8();
+        int min = getU8();
+        return WeekTime(day, Time(hour, min));
+    }
+    Lesson getLesson() {
+        int id = getI32();
+        std::string name = getStr();
+        int capacity = getI32();
+        Lesson lesson(id, name, capacity);
+        lesson.setRequiredFeatures(getFeatures());
+        uint32_t count = getU32();
+        for (uint32_t i = 0; i < count; i++) {
+            WeekTime wt = getWeekTime();
+            lesson.addSession(wt, getI32());
+        }
+        return lesson;
+    }
+    std::set<std::string> getFeatures() {
+        std::set<std::string> features;
+        for (int count = getU8(); count > 0; count--)
+            features.insert(getStr());
+        return features;
+    }
+    Person getPerson() {
+        std::string name = getStr();
+        int id = getI32();
+        bool teacher = getU8();
+        return Person(name, id, teacher);
+    }
+    ExtraLesson getExtraLesson() {
+        Date start = getDate();
+        Date end = getDate();
+        Lesson base = getLesson();
+        ExtraLesson lesson(base.getId(), base.getName(), base.getLessonMaxCapacity(), start, end);
+        lesson.setRequiredFeatures(base.getRequiredFeatures());
+        for (const auto& s: base.getSession())
+            lesson.addSession(s.first, s.second);
+        return lesson;
+    }
+};
+
+// Append-only log of LessonList mutations. Records are buffered and written with a single
+// fsync once groupSize records are pending or the oldest of them has waited groupMillis;
+// a flusher thread keeps that bound when no further record is appended. A write failed on
+// the flusher is thrown by the next append() or commit().
+// File layout: [8 byte magic][u32 version] followed by the records.
+// Record layout: [u32 payload size][u8 op][payload][u32 checksum of op + payload]
+class Journal {
+public:
+    // 2: lessons record their required features by name instead of a projector flag
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t HEADER_SIZE = 12;
+
+    enum class Op : uint8_t {
+        addPerson = 1,
+        pushLesson,
+        pushExtraLesson,
+        addSession,
+        setClassroom,
+        setTeacher,
+        addStudent,
+        dropStudent,
+        waitlistStudent,
+        assignClassrooms,
+        unassignTeacher,
+        unassignClassroom,
+        removeLesson,
+        removeSession,
+        moveSession
+    };
+
+private:
+    FILE* file;
+    // end of the records known to be on disk; only changed by the writer holding writing
+    long written = 0;
+    std::string pending;
+    size_t pendingRecords = 0;
+    size_t groupSize;
+    std::chrono::milliseconds groupMillis;
+    std::chrono::steady_clock::time_point firstPending;
+    std::mutex lock;
+    std::mutex writing;
+    std::condition_variable wake;
+    std::thread flusher;
+    bool stopping = false;
+    // a write failed and its records wait in pending until check() or commit() retries them
+    bool failed = false;
+    // a failed write couldn't be cut off the file, so nothing more can be appended safely
+    bool broken = false;
+
+    static uint32_t checksum(const char* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+    static std::string header() {
+        ByteWriter version;
+        version.putU32(VERSION);
+        return std::string("QTCJRNL", 8) + version.data();
+    }
+    // Writes the pending records and syncs them, without holding lock, so appends go on meanwhile.
+    // A failed write is cut off the file and its records go back in front of pending, so a retry
+    // never leaves torn or repeated records behind.
+    bool write() {
+        std::lock_guard<std::mutex> writer(writing);
+        std::string batch;
+        size_t records;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (broken)
+                return false;
+            batch.swap(pending);
+            records = pendingRecords;
+            pendingRecords = 0;
+        }
+        if (batch.empty())
+            return true;
+        if (fwrite(batch.data(), 1, batch.size(), file) == batch.size() && fsyncFile(file) == 0) {
+            written += static_cast<long>(batch.size());
+            return true;
+        }
+        clearerr(file);
+        bool rolledBack = truncateFile(file, written) == 0 && fseek(file, written, SEEK_SET) == 0;
+        std::lock_guard<std::mutex> guard(lock);
+        pending.insert(0, batch);
+        pendingRecords += records;
+        failed = true;
+        broken = !rolledBack;
+        return false;
+    }
+    void flushLoop() {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [this] { return stopping || (!pending.empty() && !failed); });
+            if (stopping)
+                return;
+            if (wake.wait_until(guard, firstPending + groupMillis, [this] { return stopping || pending.empty(); }))
+                continue;
+            guard.unlock();
+            write();
+            guard.lock();
+        }
+    }
+
+public:
+    explicit Journal(const std::string& path, size_t groupSize = 256, int groupMillis = 10)
+            : groupSize(groupSize), groupMillis(groupMillis) {
+        // drop a torn tail left by a crash so new records are not appended after garbage
+        long valid = static_cast<long>(scan(path, nullptr));
+        file = fopen(path.c_str(), "r+b");
+        if (!file)
+            file = fopen(path.c_str(), "w+b");
+        if (!file)
+            throw "Couldn't Open Journal!";
+        // unbuffered, so a failed write leaves nothing behind in stdio to come out later
+        setvbuf(file, nullptr, _IONBF, 0);
+        if (truncateFile(file, valid) != 0 || fseek(file, valid, SEEK_SET) != 0) {
+            fclose(file);
+            throw "Couldn't Open Journal!";
+        }
+        written = valid;
+        if (valid == 0) {
+            pending = header();
+            if (!write()) {
+                fclose(file);
+                throw "Couldn't Open Journal!";
+            }
+        }
+        flusher = std::thread(&Journal::flushLoop, this);
+    }
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    // A destructor can't throw, so a failed final write is only reported; call commit()
+    // before destroying the journal where that failure has to be handled.
+    ~Journal() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        flusher.join();
+        try {
+            commit();
+        }
+        catch (char const* s) {
+            std::cerr << s << std::endl;
+        }
+        fclose(file);
+    }
+    // Throws a failed background write before the caller changes anything. The failed records stay
+    // pending and are retried.
+    void check() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (broken)
+            throw "Couldn't Write Journal!";
+        if (failed) {
+            failed = false;
+            wake.notify_one();
+            throw "Couldn't Write Journal!";
+        }
+    }
+    // Never throws: the operation is already applied. A failed write comes out of the next check().
+    void append(Op op, const ByteWriter& payload) {
+        bool full;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            const std::string& data = payload.data();
+            size_t start = pending.size();
+            if (pending.empty()) {
+                firstPending = std::chrono::steady_clock::now();
+                wake.notify_one();
+            }
+            ByteWriter header;
+            header.putU32(static_cast<uint32_t>(data.size()));
+            header.putU8(static_cast<uint8_t>(op));
+            pending.append(header.data());
+            pending.append(data);
+            ByteWriter tail;
+            tail.putU32(checksum(pending.data() + start + 4, data.size() + 1));
+            pending.append(tail.data());
+            ++pendingRecords;
+            full = pendingRecords >= groupSize && !failed;
+        }
+        if (full)
+            write();
+    }
+    // Writes the pending records now
+    void commit() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            failed = false;
+        }
+        if (!write())
+            throw "Couldn't Write Journal!";
+    }
+    // Calls apply for every intact record and returns the length of the valid prefix, header
+    // included. Throws on files of another format or version.
+    static size_t scan(const std::string& path, const std::function<void(Op, ByteReader&)>& apply) {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+            return 0;
+        std::string content;
+        char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+            content.append(chunk, n);
+        fclose(in);
+        // a header torn while the journal was created leaves an empty journal
+        if (content.size() < HEADER_SIZE && header().compare(0, content.size(), content) == 0)
+            return 0;
+        if (content.compare(0, 8, std::string("QTCJRNL", 8)) != 0)
+            throw "Not a Journal!";
+        if (ByteReader(content.data() + 8, 4).getU32() != VERSION)
+            throw "Unsupported Journal Version!";
+        size_t offset = HEADER_SIZE;
+        while (content.size() - offset >= 9) {
+            ByteReader header(content.data() + offset, 4);
+            uint32_t size = header.getU32();
+            if (content.size() - offset - 9 < size)
+                break;
+            const char* body = content.data() + offset + 4;
+            ByteReader tail(body + 1 + size, 4);
+            if (tail.getU32() != checksum(body, size + 1))
+                break;
+            if (apply) {
+                ByteReader payload(body + 1, size);
+                apply(static_cast<Op>(static_cast<uint8_t>(*body)), payload);
+            }
+            offset += 9 + size;
+        }
+        return offset;
+    }
+};
+
+// Read-only view over a term snapshot file. All records are fixed size and refer to each
+// other by index or string pool offset, so the file is used straight from the mapping.
+class TermSnapshot {
+public:
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        int32_t start[3];
+        int32_t end[3];
+        uint32_t classroomOffset, classroomCount;
+        uint32_t personOffset, personCount;
+        uint32_t lessonOffset, lessonCount;
+        uint32_t lessonIndexOffset;
+        uint32_t sessionOffset, sessionCount;
+        uint32_t studentOffset, studentCount;
+        uint32_t stringOffset, stringSize;
+        uint32_t featureOffset, featureCount;
+    };
+    // bit i of a feature mask in the file is the feature named by the i-th record
+    struct FeatureRecord {
+        uint32_t nameOffset;
+        uint32_t nameSize;
+    };
+    struct ClassroomRecord {
+        int32_t number;
+        int32_t capacity;
+        uint32_t features;
+    };
+    struct PersonRecord {
+        int32_t id;
+        uint32_t nameOffset;
+        uint32_t nameSize;
+        uint32_t teacher;
+    };
+    struct SessionRecord {
+        uint8_t day;
+        uint8_t hour;
+        uint8_t min;
+        uint8_t reserved;
+        int32_t duration;
+    };
+    struct LessonRecord {
+        int32_t id;
+        uint32_t nameOffset;
+        uint32_t nameSize;
+        int32_t capacity;
+        uint32_t features;
+        uint32_t extra;
+        int32_t start[3];
+        int32_t end[3];
+        uint32_t firstSession, sessionCount;
+        uint32_t firstStudent, studentCount;
+        int32_t classroom;
+        int32_t teacher;
+    };
+
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+    std::string fallback;
+#ifndef _WIN32
+    void* mapping = nullptr;
+#endif
+
+    template<typename T>
+    const T* section(uint32_t offset) const {
+        return reinterpret_cast<const T*>(base + offset);
+    }
+    void checkSection(uint32_t offset, uint32_t count, size_t recordSize) const {
+        if (offset % 4 != 0 || offset > size || (size - offset) / recordSize < count)
+            throw "Corrupt Snapshot!";
+    }
+    void validate() const {
+        if (size < sizeof(Header))
+            throw "Corrupt Snapshot!";
+        const Header& h = header();
+        if (std::string(h.magic, 8) != std::string("QTCTERM", 8))
+            throw "Not a Term Snapshot!";
+        if (h.version != VERSION || h.byteOrder != BYTE_ORDER_MARK)
+            throw "Unsupported Snapshot Version!";
+        checkSection(h.classroomOffset, h.classroomCount, sizeof(ClassroomRecord));
+        checkSection(h.personOffset, h.personCount, sizeof(PersonRecord));
+        checkSection(h.lessonOffset, h.lessonCount, sizeof(LessonRecord));
+        checkSection(h.lessonIndexOffset, h.lessonCount, sizeof(uint32_t));
+        checkSection(h.sessionOffset, h.sessionCount, sizeof(SessionRecord));
+        checkSection(h.studentOffset, h.studentCount, sizeof(int32_t));
+        checkSection(h.featureOffset, h.featureCount, sizeof(FeatureRecord));
+        if (h.stringOffset > size || size - h.stringOffset < h.stringSize || h.featureCount > Features::MAX_FEATURES)
+            throw "Corrupt Snapshot!";
+        for (uint32_t i = 0; i < h.featureCount; i++) {
+            const FeatureRecord& f = section<FeatureRecord>(h.featureOffset)[i];
+            if (f.nameOffset > h.stringSize || h.stringSize - f.nameOffset < f.nameSize)
+                throw "Corrupt Snapshot!";
+        }
+        // a mask may only use the bits of the feature names stored
+        const uint32_t knownFeatures = h.featureCount == 32 ? ~uint32_t(0) : (uint32_t(1) << h.featureCount) - 1;
+        std::vector<int32_t> rooms;
+        for (uint32_t i = 0; i < h.classroomCount; i++) {
+            if (classroomAt(i).features & ~knownFeatures)
+                throw "Corrupt Snapshot!";
+            rooms.push_back(classroomAt(i).number);
+        }
+        std::sort(rooms.begin(), rooms.end());
+        for (uint32_t i = 0; i < h.personCount; i++)
+            if (personAt(i).nameOffset > h.stringSize || h.stringSize - personAt(i).nameOffset < personAt(i).nameSize ||
+                (i > 0 && personAt(i - 1).id >= personAt(i).id))
+                throw "Corrupt Snapshot!";
+        for (uint32_t i = 0; i < h.sessionCount; i++) {
+            const SessionRecord& s = section<SessionRecord>(h.sessionOffset)[i];
+            if (s.day > static_cast<uint8_t>(Day::fri) || s.hour > 23 || s.min > 59 || s.duration < 1 || s.duration > MAX_SESSION_DURATION_MINUTES)
+                throw "Corrupt Snapshot!";
+        }
+        const uint32_t* index = section<uint32_t>(h.lessonIndexOffset);
+        for (uint32_t i = 0; i < h.lessonCount; i++) {
+            const LessonRecord& l = lessonAt(i);
+            if (l.nameOffset > h.stringSize || h.stringSize - l.nameOffset < l.nameSize ||
+                l.firstSession > h.sessionCount || h.sessionCount - l.firstSession < l.sessionCount ||
+                l.firstStudent > h.studentCount || h.studentCount - l.firstStudent < l.studentCount ||
+                (l.features & ~knownFeatures) || index[i] >= h.lessonCount ||
+                (i > 0 && lessonAt(index[i - 1]).id >= lessonAt(index[i]).id))
+                throw "Corrupt Snapshot!";
+            if ((l.classroom != -1 && !std::binary_search(rooms.begin(), rooms.end(), l.classroom)) ||
+                (l.teacher != -1 && !findPerson(l.teacher)))
+                throw "Corrupt Snapshot!";
+            for (uint32_t j = 0; j < l.studentCount; j++)
+                if (!findPerson(students(l)[j]))
+                    throw "Corrupt Snapshot!";
+        }
+    }
+
+public:
+    explicit TermSnapshot(const std::string& path) {
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw "Couldn't Open Snapshot!";
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = static_cast<size_t>(st.st_size);
+            mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED || mapping == nullptr) {
+            mapping = nullptr;
+            throw "Couldn't Map Snapshot!";
+        }
+        base = static_cast<const char*>(mapping);
+#else
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+            throw "Couldn't Open Snapshot!";
+        char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+            fallback.append(chunk, n);
+        fclose(in);
+        base = fallback.data();
+        size = fallback.size();
+#endif
+        try {
+            validate();
+        }
+        catch (...) {
+            release();
+            throw;
+        }
+    }
+    TermSnapshot(const TermSnapshot&) = delete;
+    TermSnapshot& operator=(const TermSnapshot&) = delete;
+    ~TermSnapshot() {
+        release();
+    }
+    void release() {
+#ifndef _WIN32
+        if (mapping)
+            munmap(mapping, size);
+        mapping = nullptr;
+#endif
+        base = nullptr;
+        size = 0;
+    }
+    const Header& header() const {
+        return *section<Header>(0);
+    }
+    Date getStart() const {
+        return Date(header().start[0], header().start[1], header().start[2]);
+    }
+    Date getEnd() const {
+        return Date(header().end[0], header().end[1], header().end[2]);
+    }
+    uint32_t classroomCount() const {
+        return header().classroomCount;
+    }
+    const ClassroomRecord& classroomAt(uint32_t i) const {
+        return section<ClassroomRecord>(header().classroomOffset)[i];
+    }
+    uint32_t personCount() const {
+        return header().personCount;
+    }
+    const PersonRecord& personAt(uint32_t i) const {
+        return section<PersonRecord>(header().personOffset)[i];
+    }
+    // people are stored sorted by id
+    const PersonRecord* findPerson(int id) const {
+        const PersonRecord* first = section<PersonRecord>(header().personOffset);
+        const PersonRecord* last = first + header().personCount;
+        auto it = std::lower_bound(first, last, id, [](const PersonRecord& p, int v) { return p.id < v; });
+        return it != last && it->id == id ? it : nullptr;
+    }
+    uint32_t lessonCount() const {
+        return header().lessonCount;
+    }
+    // lessons are stored in term order; the index section orders them by id
+    const LessonRecord& lessonAt(uint32_t i) const {
+        return section<LessonRecord>(header().lessonOffset)[i];
+    }
+    const LessonRecord* findLesson(int id) const {
+        const uint32_t* first = section<uint32_t>(header().lessonIndexOffset);
+        const uint32_t* last = first + header().lessonCount;
+        auto it = std::lower_bound(first, last, id, [this](uint32_t i, int v) { return lessonAt(i).id < v; });
+        return it != last && lessonAt(*it).id == id ? &lessonAt(*it) : nullptr;
+    }
+    const SessionRecord* sessions(const LessonRecord& lesson) const {
+        return section<SessionRecord>(header().sessionOffset) + lesson.firstSession;
+    }
+    const int32_t* students(const LessonRecord& lesson) const {
+        return section<int32_t>(header().studentOffset) + lesson.firstStudent;
+    }
+    std::string_view name(const PersonRecord& person) const {
+        return std::string_view(base + header().stringOffset + person.nameOffset, person.nameSize);
+    }
+    std::string_view name(const LessonRecord& lesson) const {
+        return std::string_view(base + header().stringOffset + lesson.nameOffset, lesson.nameSize);
+    }
+    // the names of the features set in a mask of the file
+    std::set<std::string> features(uint32_t stored) const {
+        std::set<std::string> set;
+        const FeatureRecord* names = section<FeatureRecord>(header().featureOffset);
+        for (uint32_t i = 0; i < header().featureCount; i++)
+            if (stored & (uint32_t(1) << i))
+                set.emplace(base + header().stringOffset + names[i].nameOffset, names[i].nameSize);
+        return set;
+    }
+};
 
 class LessonList {
     friend Lesson;
-    std::vector<Lesson> lessonList;
-    std::vector<ExtraLesson> extraLessonList;
+    // keyed by id, so lookups, inserts and removals stay logarithmic and iteration is in id order
+    std::map<int, Lesson> lessonList;
+    std::map<int, ExtraLesson> extraLessonList;
     ClassroomList classroomList;
     PersonList personList;
     std::map<int, int> lessonListLocation;
     std::map<int, int> lessonListTeacher;
-    std::map<int, std::vector<int>> lessonListStudentList;
+    std::map<int, std::set<int>> lessonListStudentList;
     Date start, end;
+    Journal* journal = nullptr;
+    std::map<int, Timeline> classroomTimeline;
+    std::map<int, Timetable> personTimetable;
+    std::map<int, Waitlist> lessonWaitlist;
+
+    static TimeSlot slotOf(const Lesson& lesson, const WeekTime& wt, int durationMin) {
+        TimeSlot slot = TimeSlot::of(wt, durationMin, lesson.getId());
+        if (const auto* extra = dynamic_cast<const ExtraLesson*>(&lesson)) {
+            slot.from = extra->getStart().toOrdinal();
+            slot.to = extra->getEnd().toOrdinal();
+        }
+        return slot;
+    }
+    std::vector<TimeSlot> slotsOf(const Lesson& lesson) const {
+        std::vector<TimeSlot> slots;
+        for (const auto& s: lesson.getSession())
+            slots.push_back(slotOf(lesson, s.first, s.second));
+        return slots;
+    }
+    void insertLesson(const Lesson& lesson) {
+        if (!lessonList.emplace(lesson.getId(), lesson).second)
+            throw "Duplicate ID";
+    }
+    void bookClassroom(const Lesson& lesson, int classroomNumber) {
+        if (classroomNumber == -1)
+            return;
+        Timeline& timeline = classroomTimeline[classroomNumber];
+        for (const auto& slot: slotsOf(lesson))
+            timeline.add(slot);
+    }
+    void bookPerson(const Lesson& lesson, int personId) {
+        if (personId == -1)
+            return;
+        Timetable& timetable = personTimetable[personId];
+        int classroom = lessonListLocation.at(lesson.getId());
+        for (const auto& slot: slotsOf(lesson))
+            timetable.add(slot, classroom);
+    }
+    void releasePerson(const Lesson& lesson, int personId) {
+        auto it = personTimetable.find(personId);
+        if (it == personTimetable.end())
+            return;
+        for (const auto& slot: slotsOf(lesson))
+            it->second.remove(slot);
+    }
+    void moveAttendees(int lessonId, int classroomNumber) {
+        if (auto it = personTimetable.find(lessonListTeacher.at(lessonId)); it != personTimetable.end())
+            it->second.setClassroom(lessonId, classroomNumber);
+        for (int student: lessonListStudentList.at(lessonId))
+            personTimetable[student].setClassroom(lessonId, classroomNumber);
+    }
+    void releaseClassroom(const Lesson& lesson, int classroomNumber) {
+        auto it = classroomTimeline.find(classroomNumber);
+        if (it == classroomTimeline.end())
+            return;
+        for (const auto& slot: slotsOf(lesson))
+            it->second.remove(slot);
+    }
+    LessonList(const ClassroomList& classrooms, const Date& start, const Date& anEnd)
+            : classroomList(classrooms), start(start), end(anEnd) {}
+    // Bulk load path for saved terms: the term was consistent when saved, so assignments are restored without re-checking conflicts
+    void restoreLesson(const Lesson& lesson, int classroom, int teacher, std::set<int> students) {
+        insertLesson(lesson);
+        if (const auto* extra = dynamic_cast<const ExtraLesson*>(&lesson))
+            extraLessonList.emplace(lesson.getId(), *extra);
+        lessonListLocation[lesson.getId()] = classroom;
+        bookClassroom(lesson, classroom);
+        lessonListTeacher[lesson.getId()] = teacher;
+        bookPerson(lesson, teacher);
+        for (int student: students)
+            bookPerson(lesson, student);
+        lessonListStudentList[lesson.getId()] = std::move(students);
+    }
+    ExtraLesson* findExtraLesson(int lessonID) {
+        auto it = extraLessonList.find(lessonID);
+        return it == extraLessonList.end() ? nullptr : &it->second;
+    }
+    void conflictSlotClassroom(const TimeSlot& slot, const int classroomNumber) const {
+        auto timeline = classroomTimeline.find(classroomNumber);
+        if (timeline == classroomTimeline.end())
+            return;
+        if (const TimeSlot* old = timeline->second.findConflict(slot)) {
+            conflict_error e(old->begin, slot.lessonId, old->lessonId);
+            e.setClassroom(classroomNumber);
+            throw e;
+        }
+    }
+    void conflictSlotPerson(const TimeSlot& slot, const int personID) const {
+        auto timetable = personTimetable.find(personID);
+        if (timetable == personTimetable.end())
+            return;
+        if (const TimeSlot* old = timetable->second.findConflict(slot)) {
+            throw conflict_error(old->begin, slot.lessonId, old->lessonId);
+        }
+    }
+    // Takes the session out of the lesson, its classroom timeline and its attendees' timetables; returns its duration
+    int detachSession(const int lessonId, const WeekTime& wt) {
+        Lesson& lesson = lessonList.at(lessonId);
+        ExtraLesson* extra = findExtraLesson(lessonId);
+        const Lesson& current = extra ? *extra : lesson;
+        auto session = current.getSession().find(wt);
+        if (session == current.getSession().end())
+            throw "Couldn't Find Such a Session!";
+        int duration = session->second;
+        TimeSlot slot = slotOf(current, wt, duration);
+        if (auto timeline = classroomTimeline.find(lessonListLocation.at(lessonId)); timeline != classroomTimeline.end())
+            timeline->second.remove(slot);
+        if (auto timetable = personTimetable.find(lessonListTeacher.at(lessonId)); timetable != personTimetable.end())
+            timetable->second.remove(slot);
+        for (int student: lessonListStudentList.at(lessonId))
+            personTimetable[student].remove(slot);
+        lesson.removeSession(wt);
+        if (extra)
+            extra->removeSession(wt);
+        return duration;
+    }
+    void conflictClassroom(const Lesson& lesson, const int classroomNumber) const {
+        for (const auto& slot: slotsOf(lesson))
+            conflictSlotClassroom(slot, classroomNumber);
+    }
+    FeatureMask requiredMask(const Lesson& lesson) const {
+        return classroomList.getFeatures().mask(lesson.getRequiredFeatures());
+    }
+    // Mutators call this first, so a journal that can't be written stops them before the term changes
+    void checkJournal() const {
+        if (journal)
+            journal->check();
+    }
 
 public:
     LessonList(const Date &start, const Date &anEnd) : start(start), end(anEnd) {}
+    // Copies the snapshot into a term that can change; read-only lookups can use the TermSnapshot itself
+    explicit LessonList(const TermSnapshot& snapshot)
+            : classroomList(snapshotClassrooms(snapshot)), start(snapshot.getStart()), end(snapshot.getEnd()) {
+        for (uint32_t i = 0; i < snapshot.personCount(); i++) {
+            const auto& p = snapshot.personAt(i);
+            personList.addPerson(Person(std::string(snapshot.name(p)), p.id, p.teacher));
+        }
+        for (uint32_t i = 0; i < snapshot.lessonCount(); i++) {
+            const auto& l = snapshot.lessonAt(i);
+            ExtraLesson lesson(l.id, std::string(snapshot.name(l)), l.capacity, Date(l.start[0], l.start[1], l.start[2]),
+                               Date(l.end[0], l.end[1], l.end[2]));
+            lesson.setRequiredFeatures(snapshot.features(l.features));
+            const auto* sessions = snapshot.sessions(l);
+            for (uint32_t j = 0; j < l.sessionCount; j++)
+                lesson.addSession(WeekTime(static_cast<Day>(sessions[j].day), Time(sessions[j].hour, sessions[j].min)), sessions[j].duration);
+            std::set<int> students(snapshot.students(l), snapshot.students(l) + l.studentCount);
+            if (l.extra)
+                restoreLesson(lesson, l.classroom, l.teacher, std::move(students));
+            else
+                restoreLesson(Lesson(lesson), l.classroom, l.teacher, std::move(students));
+        }
+    }
+    static ClassroomList snapshotClassrooms(const TermSnapshot& snapshot) {
+        std::vector<Classroom> list;
+        Features names;
+        list.reserve(snapshot.classroomCount());
+        for (uint32_t i = 0; i < snapshot.classroomCount(); i++) {
+            const auto& c = snapshot.classroomAt(i);
+            FeatureMask mask = 0;
+            for (const auto& name: snapshot.features(c.features))
+                mask |= names.bit(name);
+            list.emplace_back(c.number, c.capacity, false);
+            list.back().setFeatures(mask);
+        }
+        return ClassroomList(list, names);
+    }
+    void writeSnapshot(const std::string& path) const {
+        using S = TermSnapshot;
+        S::Header h{};
+        std::memcpy(h.magic, "QTCTERM", 8);
+        h.version = S::VERSION;
+        h.byteOrder = S::BYTE_ORDER_MARK;
+        h.start[0] = start.getDay(); h.start[1] = start.getMonth(); h.start[2] = start.getYear();
+        h.end[0] = end.getDay(); h.end[1] = end.getMonth(); h.end[2] = end.getYear();
+
+        // the rooms' feature names, then those only lessons require
+        Features names = classroomList.getFeatures();
+        for (const auto& plain: lessonList)
+            for (const auto& name: getLesson(plain.first).getRequiredFeatures())
+                names.bit(name);
+        std::string strings;
+        std::vector<S::FeatureRecord> features;
+        for (const auto& name: names.list()) {
+            features.push_back({static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(name.size())});
+            strings.append(name);
+        }
+        std::vector<S::ClassroomRecord> rooms;
+        for (const auto& c: classroomList.getList())
+            rooms.push_back({c.getNumber(), c.getCapacity(), c.getFeatures()});
+        std::vector<S::PersonRecord> people;
+        for (const auto& p: personList.getPersonList()) {
+            people.push_back({p.getId(), static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(p.getName().size()), p.isTeacher()});
+            strings.append(p.getName());
+        }
+        std::vector<S::LessonRecord> lessons;
+        std::vector<S::SessionRecord> sessions;
+        std::vector<int32_t> students;
+        for (const auto& plain: lessonList) {
+            const Lesson& lesson = getLesson(plain.first);
+            S::LessonRecord l{};
+            l.id = lesson.getId();
+            l.nameOffset = static_cast<uint32_t>(strings.size());
+            l.nameSize = static_cast<uint32_t>(lesson.getName().size());
+            strings.append(lesson.getName());
+            l.capacity = lesson.getLessonMaxCapacity();
+            l.features = names.mask(lesson.getRequiredFeatures());
+            if (const auto* extra = dynamic_cast<const ExtraLesson*>(&lesson)) {
+                l.extra = 1;
+                l.start[0] = extra->getStart().getDay(); l.start[1] = extra->getStart().getMonth(); l.start[2] = extra->getStart().getYear();
+                l.end[0] = extra->getEnd().getDay(); l.end[1] = extra->getEnd().getMonth(); l.end[2] = extra->getEnd().getYear();
+            }
+            else {
+                l.start[0] = start.getDay(); l.start[1] = start.getMonth(); l.start[2] = start.getYear();
+                l.end[0] = end.getDay(); l.end[1] = end.getMonth(); l.end[2] = end.getYear();
+            }
+            l.firstSession = static_cast<uint32_t>(sessions.size());
+            for (const auto& s: lesson.getSession())
+                sessions.push_back({static_cast<uint8_t>(s.first.getDay()), static_cast<uint8_t>(s.first.getTime().getHour()),
+                                    static_cast<uint8_t>(s.first.getTime().getMin()), 0, s.second});
+            l.sessionCount = static_cast<uint32_t>(sessions.size()) - l.firstSession;
+            const auto& enrolled = lessonListStudentList.at(lesson.getId());
+            l.firstStudent = static_cast<uint32_t>(students.size());
+            students.insert(students.end(), enrolled.begin(), enrolled.end());
+            l.studentCount = static_cast<uint32_t>(enrolled.size());
+            l.classroom = lessonListLocation.at(lesson.getId());
+            l.teacher = lessonListTeacher.at(lesson.getId());
+            lessons.push_back(l);
+        }
+        std::vector<uint32_t> lessonIndex(lessons.size());
+        for (uint32_t i = 0; i < lessonIndex.size(); i++)
+            lessonIndex[i] = i;
+        std::sort(lessonIndex.begin(), lessonIndex.end(), [&lessons](uint32_t a, uint32_t b) { return lessons[a].id < lessons[b].id; });
+
+        std::string out(sizeof(S::Header), '\0');
+        auto place = [&out](const void* data, size_t bytes) {
+            out.resize((out.size() + 7) & ~static_cast<size_t>(7), '\0');
+            auto offset = static_cast<uint32_t>(out.size());
+            out.append(static_cast<const char*>(data), bytes);
+            return offset;
+        };
+        h.classroomOffset = place(rooms.data(), rooms.size() * sizeof(S::ClassroomRecord));
+        h.classroomCount = static_cast<uint32_t>(rooms.size());
+        h.personOffset = place(people.data(), people.size() * sizeof(S::PersonRecord));
+        h.personCount = static_cast<uint32_t>(people.size());
+        h.lessonOffset = place(lessons.data(), lessons.size() * sizeof(S::LessonRecord));
+        h.lessonCount = static_cast<uint32_t>(lessons.size());
+        h.lessonIndexOffset = place(lessonIndex.data(), lessonIndex.size() * sizeof(uint32_t));
+        h.sessionOffset = place(sessions.data(), sessions.size() * sizeof(S::SessionRecord));
+        h.sessionCount = static_cast<uint32_t>(sessions.size());
+        h.studentOffset = place(students.data(), students.size() * sizeof(int32_t));
+        h.studentCount = static_cast<uint32_t>(students.size());
+        h.featureOffset = place(features.data(), features.size() * sizeof(S::FeatureRecord));
+        h.featureCount = static_cast<uint32_t>(features.size());
+        h.stringOffset = place(strings.data(), strings.size());
+        h.stringSize = static_cast<uint32_t>(strings.size());
+        std::memcpy(&out[0], &h, sizeof(h));
+
+        // write next to the target and rename, so a crash never leaves a half written snapshot behind
+        std::string temp = path + ".tmp";
+        FILE* file = fopen(temp.c_str(), "wb");
+        if (!file)
+            throw "Couldn't Write Snapshot!";
+        bool ok = fwrite(out.data(), 1, out.size(), file) == out.size() && fflush(file) == 0 && fsyncFile(file) == 0;
+        fclose(file);
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        if (!ok || std::rename(temp.c_str(), path.c_str()) != 0)
+            throw "Couldn't Write Snapshot!";
+    }
     const Lesson& getLesson(int lessonID) const {
-        for (const auto& i : extraLessonList)
-            if(i.getId() == lessonID)
-                return i;
-        return lessonList.at(binarySearch(lessonList, &Lesson::getId, lessonID));
+        if (auto extra = extraLessonList.find(lessonID); extra != extraLessonList.end())
+            return extra->second;
+        return lessonList.at(lessonID);
+    }
+    void attachJournal(Journal* j) {
+        journal = j;
+    }
+    void replayJournal(const std::string& path) {
+        Journal* attached = journal;
+        journal = nullptr;
+        try {
+            Journal::scan(path, [this](Journal::Op op, ByteReader& in) {
+                switch (op) {
+                    case Journal::Op::addPerson: personList.addPerson(in.getPerson()); break;
+                    case Journal::Op::pushLesson: pushLesson(in.getLesson()); break;
+                    case Journal::Op::pushExtraLesson: pushExtraLesson(in.getExtraLesson()); break;
+                    case Journal::Op::addSession: {
+                        int lessonId = in.getI32();
+                        WeekTime wt = in.getWeekTime();
+                        addSession(lessonId, wt, in.getI32());
+                        break;
+                    }
+                    case Journal::Op::setClassroom: {
+                        int lessonId = in.getI32();
+                        setClassroom(lessonId, in.getI32());
+                        break;
+                    }
+                    case Journal::Op::setTeacher: {
+                        int teacherId = in.getI32();
+                        setTeacher(teacherId, in.getI32());
+                        break;
+                    }
+                    case Journal::Op::addStudent: {
+                        int studentId = in.getI32();
+                        addStudent(studentId, in.getI32());
+                        break;
+                    }
+                    case Journal::Op::dropStudent: {
+                        int studentId = in.getI32();
+                        dropStudent(studentId, in.getI32());
+                        break;
+                    }
+                    case Journal::Op::waitlistStudent: {
+                        int studentId = in.getI32();
+                        int lessonId = in.getI32();
+                        waitlistStudent(studentId, lessonId, in.getI32());
+                        break;
+                    }
+                    case Journal::Op::assignClassrooms: {
+                        std::vector<std::pair<int, int>> changes(in.getU32());
+                        for (auto& c: changes) {
+                            c.first = in.getI32();
+                            c.second = in.getI32();
+                        }
+                        assignClassrooms(changes);
+                        break;
+                    }
+                    case Journal::Op::unassignTeacher: unassignTeacher(in.getI32()); break;
+                    case Journal::Op::unassignClassroom: unassignClassroom(in.getI32()); break;
+                    case Journal::Op::removeLesson: removeLesson(in.getI32()); break;
+                    case Journal::Op::removeSession: {
+                        int lessonId = in.getI32();
+                        removeSession(lessonId, in.getWeekTime());
+                        break;
+                    }
+                    case Journal::Op::moveSession: {
+                        int lessonId = in.getI32();
+                        WeekTime from = in.getWeekTime();
+                        WeekTime to = in.getWeekTime();
+                        moveSession(lessonId, from, to, in.getI32());
+                        break;
+                    }
+                }
+            });
+        }
+        catch (...) {
+            journal = attached;
+            throw;
+        }
+        journal = attached;
     }
     const ClassroomList& getClassroomList() const {
         return classroomList;
@@ -652,22 +2307,11 @@ public:
     const PersonList& getPersonList() const {
         return personList;
     }
-    void conflictLesson (const int newLessonId, const int classroomNumber) {
-        if (lessonListTeacher[newLessonId] != -1 || !lessonListStudentList[newLessonId].empty())
-            throw "You are not allowed to add session after assigning Teacher or Student to this Lesson!";
-        for (const auto& elem: lessonListLocation) {
-            if (elem.second == classroomNumber) {
-                try {
-                    getLesson(elem.first).conflictLessonTime(getLesson(newLessonId));
-                }
-                catch (conflict_error& e) {
-                    e.setWith(e.getWith() + " at the class number" + std::to_string(elem.second));
-                    throw;
-                }
-            }
-        }
+    void conflictLesson (const int newLessonId, const int classroomNumber) const {
+        conflictClassroom(getLesson(newLessonId), classroomNumber);
     }
     void setClassroom(const int lessonId, const int classroomNumber) {
+        checkJournal();
         try {
             conflictLesson(lessonId, classroomNumber);
         }
@@ -675,39 +2319,234 @@ public:
             throw;
         }
         if (lessonListLocation.find(lessonId) == lessonListLocation.end() && classroomList.getClassroomInfo(classroomNumber).getCapacity() >= getLesson(lessonId).getLessonMaxCapacity() &&
-            (!getLesson(lessonId).getNeedProjector() || classroomList.getClassroomInfo(classroomNumber).isProjector()))
+            classroomList.getClassroomInfo(classroomNumber).hasFeatures(requiredMask(getLesson(lessonId))))
             lessonListLocation.insert(std::make_pair(lessonId, classroomNumber));
         else if (lessonListLocation.find(lessonId) != lessonListLocation.end() && classroomList.getClassroomInfo(classroomNumber).getCapacity() >= getLesson(lessonId).getLessonMaxCapacity() &&
-                 (!getLesson(lessonId).getNeedProjector() ||
-                  classroomList.getClassroomInfo(classroomNumber).isProjector())) {
+                 classroomList.getClassroomInfo(classroomNumber).hasFeatures(requiredMask(getLesson(lessonId)))) {
+            releaseClassroom(getLesson(lessonId), lessonListLocation[lessonId]);
             lessonListLocation[lessonId] = classroomNumber;
         }
+        else
+            return;
+        bookClassroom(getLesson(lessonId), classroomNumber);
+        moveAttendees(lessonId, classroomNumber);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            w.putI32(classroomNumber);
+            journal->append(Journal::Op::setClassroom, w);
+        }
+        promote(lessonId);
+    }
+    // Only the new session is checked: against the lesson's own sessions, the classroom timeline
+    // and the timetables of the teacher and the enrolled students
+    void addSession(const int lessonId, const WeekTime& new_wt, int durationMin) {
+        checkJournal();
+        Lesson& lesson = lessonList.at(lessonId);
+        ExtraLesson* extra = findExtraLesson(lessonId);
+        const Lesson& current = extra ? *extra : lesson;
+        current.checkNewSession(new_wt, durationMin);
+        TimeSlot slot = slotOf(current, new_wt, durationMin);
+        int classroom = lessonListLocation.at(lessonId);
+        int teacher = lessonListTeacher.at(lessonId);
+        const auto& students = lessonListStudentList.at(lessonId);
+        conflictSlotClassroom(slot, classroom);
+        conflictSlotPerson(slot, teacher);
+        for (int student: students)
+            conflictSlotPerson(slot, student);
+
+        lesson.addSession(new_wt, durationMin);
+        if (extra)
+            extra->addSession(new_wt, durationMin);
+        if (classroom != -1)
+            classroomTimeline[classroom].add(slot);
+        if (teacher != -1)
+            personTimetable[teacher].add(slot, classroom);
+        for (int student: students)
+            personTimetable[student].add(slot, classroom);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            w.putWeekTime(new_wt);
+            w.putI32(durationMin);
+            journal->append(Journal::Op::addSession, w);
+        }
+    }
+    void removeSession(const int lessonId, const WeekTime& wt) {
+        checkJournal();
+        if (getLesson(lessonId).getSession().size() == 1)
+            throw "Session is Empty!";
+        detachSession(lessonId, wt);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            w.putWeekTime(wt);
+            journal->append(Journal::Op::removeSession, w);
+        }
+    }
+    void moveSession(const int lessonId, const WeekTime& from, const WeekTime& to, int durationMin) {
+        checkJournal();
+        int oldDuration = detachSession(lessonId, from);
+        Journal* attached = journal;
+        journal = nullptr;
+        try {
+            addSession(lessonId, to, durationMin);
+        }
+        catch (...) {
+            addSession(lessonId, from, oldDuration);
+            journal = attached;
+            throw;
+        }
+        journal = attached;
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            w.putWeekTime(from);
+            w.putWeekTime(to);
+            w.putI32(durationMin);
+            journal->append(Journal::Op::moveSession, w);
+        }
     }
+    // The smallest classroom with enough seats and every required feature that is free in all the lesson's sessions
     int findEmptyClass(const int newLessonId) const {
-        int minimumCapacity = getLesson(newLessonId).getLessonMaxCapacity();
-        ClassroomList app = classroomList;
-        app.removeUnderCapacity(minimumCapacity);
-        while (!app.isEmpty()) {
-            bool conflict = false;
-            auto min = app.minCapacity();
-            for (auto oldLesson: getPlannedLessonOnClassroom(min->getNumber())) {
-
-                try {
-                    getLesson(oldLesson).conflictLessonTime(getLesson(newLessonId));
-                }
-                catch (conflict_error&) {
-                    conflict = true;
-                    break;
-                }
-
-            }
-            if (!conflict)
-                return min->getNumber();
-            else
-                app.removeMinCapacityClassroom();
+        const Lesson& lesson = getLesson(newLessonId);
+        std::vector<unsigned char> eligible;
+        classroomList.filter(lesson.getLessonMaxCapacity(), requiredMask(lesson), eligible);
+        const auto& rooms = classroomList.getList();
+        std::vector<size_t> candidates;
+        for (size_t i = 0; i < eligible.size(); i++)
+            if (eligible[i])
+                candidates.push_back(i);
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&rooms](size_t a, size_t b) { return rooms[a].getCapacity() < rooms[b].getCapacity(); });
+        std::vector<TimeSlot> slots = slotsOf(lesson);
+        for (size_t i: candidates) {
+            auto timeline = classroomTimeline.find(rooms[i].getNumber());
+            if (timeline == classroomTimeline.end() ||
+                std::all_of(slots.begin(), slots.end(), [&timeline](const TimeSlot& slot) { return timeline->second.isFree(slot); }))
+                return rooms[i].getNumber();
         }
         throw "There is no Empty Class";
     }
+    // Every classroom that can hold minCapacity students, has all the required features and is free
+    // in all the given (start, duration) slots. Answered from the classroom timelines only.
+    std::vector<Classroom> findFreeClassrooms(const std::vector<std::pair<WeekTime, int>>& slots, int minCapacity = 1, FeatureMask required = 0) const {
+        std::vector<TimeSlot> probes;
+        probes.reserve(slots.size());
+        for (const auto& s: slots)
+            probes.push_back(TimeSlot::of(s.first, s.second));
+        std::vector<unsigned char> eligible;
+        classroomList.filter(minCapacity, required, eligible);
+        std::vector<Classroom> free;
+        for (size_t i = 0; i < eligible.size(); i++) {
+            if (!eligible[i])
+                continue;
+            const Classroom& room = classroomList.getList()[i];
+            auto timeline = classroomTimeline.find(room.getNumber());
+            bool isFree = true;
+            if (timeline != classroomTimeline.end())
+                for (const auto& probe: probes)
+                    if (!timeline->second.isFree(probe)) {
+                        isFree = false;
+                        break;
+                    }
+            if (isFree)
+                free.push_back(room);
+        }
+        return free;
+    }
+    // One sweep over the classroom timelines and the teachers' timetables; no conflict loops
+    TermStats computeStats() const {
+        struct LessonInfo {
+            int enrolled;
+            bool projector;
+        };
+        std::map<int, LessonInfo> lessons;
+        for (const auto& lesson: lessonList)
+            lessons.emplace_hint(lessons.end(), lesson.first,
+                                 LessonInfo{static_cast<int>(lessonListStudentList.at(lesson.first).size()), lesson.second.getNeedProjector()});
+        const int window = 7 * (MAX_START_HOUR - MIN_START_HOUR) * 60;
+        TermStats stats;
+        for (const auto& room: classroomList.getList()) {
+            ClassroomStats c{room.getNumber(), room.getCapacity(), room.isProjector(), 0, window, 0, 0, 0};
+            long long seatMinutes = 0;
+            if (auto timeline = classroomTimeline.find(room.getNumber()); timeline != classroomTimeline.end()) {
+                for (const auto& slot: timeline->second.getSlots()) {
+                    int minutes = slot.last - slot.begin + 1;
+                    const LessonInfo& info = lessons.at(slot.lessonId);
+                    c.bookedMinutes += minutes;
+                    seatMinutes += static_cast<long long>(info.enrolled) * minutes;
+                    if (room.isProjector() && !info.projector)
+                        c.projectorMinutesWithoutNeed += minutes;
+                }
+            }
+            c.utilization = static_cast<double>(c.bookedMinutes) / window;
+            c.seatEfficiency = c.bookedMinutes ? static_cast<double>(seatMinutes) / (static_cast<double>(c.bookedMinutes) * room.getCapacity()) : 0;
+            stats.bookedMinutes += c.bookedMinutes;
+            stats.availableMinutes += window;
+            stats.projectorMinutesWithoutNeed += c.projectorMinutesWithoutNeed;
+            stats.classrooms.push_back(c);
+        }
+        for (const auto& teacher: personList.getTeacherList()) {
+            int minutes = 0;
+            for (const auto& entry: getTimetable(teacher.getId()).getEntries())
+                minutes += entry.slot.last - entry.slot.begin + 1;
+            stats.teacherWeeklyHours.emplace_hint(stats.teacherWeeklyHours.end(), teacher.getId(), minutes / 60.0);
+        }
+        return stats;
+    }
+    // Moves a batch of lessons between classrooms at once, so swaps never pass through a conflicting state.
+    // The caller guarantees the final assignment is valid.
+    void assignClassrooms(const std::vector<std::pair<int, int>>& changes) {
+        checkJournal();
+        for (const auto& c: changes)
+            releaseClassroom(getLesson(c.first), lessonListLocation.at(c.first));
+        for (const auto& c: changes) {
+            lessonListLocation[c.first] = c.second;
+            bookClassroom(getLesson(c.first), c.second);
+            moveAttendees(c.first, c.second);
+        }
+        if (journal && !changes.empty()) {
+            ByteWriter w;
+            w.putU32(static_cast<uint32_t>(changes.size()));
+            for (const auto& c: changes) {
+                w.putI32(c.first);
+                w.putI32(c.second);
+            }
+            journal->append(Journal::Op::assignClassrooms, w);
+        }
+        for (const auto& c: changes)
+            promote(c.first);
+    }
+    // Improves the classroom assignment to waste fewer seats; returns the remaining wasted seat-minutes
+    long long optimizeClassrooms(const ClassroomOptimizer::Options& options = {}) {
+        std::vector<ClassroomOptimizer::Room> rooms;
+        std::map<int, int> roomIndex;
+        for (const auto& c: classroomList.getList()) {
+            roomIndex[c.getNumber()] = static_cast<int>(rooms.size());
+            rooms.push_back({c.getNumber(), c.getCapacity(), c.getFeatures()});
+        }
+        std::vector<ClassroomOptimizer::Item> items;
+        for (const auto& plain: lessonList) {
+            const Lesson& lesson = getLesson(plain.first);
+            ClassroomOptimizer::Item item{lesson.getId(), lesson.getLessonMaxCapacity(), requiredMask(lesson), 0, slotsOf(lesson), -1};
+            for (const auto& s: lesson.getSession())
+                item.minutes += s.second;
+            if (auto room = roomIndex.find(lessonListLocation.at(lesson.getId())); room != roomIndex.end())
+                item.room = room->second;
+            items.push_back(std::move(item));
+        }
+        ClassroomOptimizer optimizer(rooms, items);
+        std::vector<int> best = optimizer.run(options);
+        std::vector<std::pair<int, int>> changes;
+        for (size_t i = 0; i < items.size(); i++) {
+            int number = best[i] == -1 ? -1 : rooms[best[i]].number;
+            if (number != lessonListLocation.at(items[i].lessonId))
+                changes.emplace_back(items[i].lessonId, number);
+        }
+        assignClassrooms(changes);
+        return optimizer.cost(best);
+    }
     std::vector<int> getPlannedLessonOnClassroom(int classroomNumber) const {
         std::vector<int> list;
         for (const auto& lesLoc: lessonListLocation) {
@@ -720,7 +2559,7 @@ public:
     std::vector<int> getLessonListOfPerson(int i) const {
         std::vector<int> list;
         for (const auto& lesson: lessonListStudentList) {
-            if (lesson.second.end() != std::find(lesson.second.begin(), lesson.second.end(), i))
+            if (lesson.second.count(i))
                 list.push_back(lesson.first);
         }
         for (const auto& lesson: lessonListTeacher) {
@@ -729,38 +2568,174 @@ public:
         }
         return list;
     }
+    const Timetable& getTimetable(int personId) const {
+        static const Timetable empty;
+        auto it = personTimetable.find(personId);
+        return it == personTimetable.end() ? empty : it->second;
+    }
     void conflictPersonLessonTime(const int lessonId, const int personID) const {
-        try {
-            for (auto oldLesson : getLessonListOfPerson(personID)) {
-                getLesson(oldLesson).conflictLessonTime(getLesson(lessonId));
+        if (personTimetable.find(personID) == personTimetable.end())
+            return;
+        for (const auto& slot: slotsOf(getLesson(lessonId)))
+            conflictSlotPerson(slot, personID);
+    }
+    void enroll(int studentId, int lessonId) {
+        if (lessonListLocation[lessonId] == -1)
+            throw "set classroom!";
+        if (lessonListStudentList[lessonId].size() >= static_cast<size_t>(getLesson(lessonId).getLessonMaxCapacity()))
+            throw "Lesson is full!";
+        conflictPersonLessonTime(lessonId, studentId);
+        lessonListStudentList[lessonId].insert(studentId);
+        bookPerson(getLesson(lessonId), studentId);
+        if (auto wl = lessonWaitlist.find(lessonId); wl != lessonWaitlist.end())
+            wl->second.remove(studentId);
+    }
+    // Fills free seats from the waitlist. Each candidate costs one probe of their timetable; a candidate
+    // whose schedule now conflicts loses the place in the queue.
+    void promote(int lessonId) {
+        auto wl = lessonWaitlist.find(lessonId);
+        // without a classroom nobody can be enrolled, so the queue waits for setClassroom or assignClassrooms
+        if (wl == lessonWaitlist.end() || lessonListLocation.at(lessonId) == -1)
+            return;
+        const auto capacity = static_cast<size_t>(getLesson(lessonId).getLessonMaxCapacity());
+        while (lessonListStudentList.at(lessonId).size() < capacity && !wl->second.empty()) {
+            int student = wl->second.pop();
+            try {
+                enroll(student, lessonId);
+            }
+            catch (conflict_error&) {
             }
-        }
-        catch (conflict_error& e){
-            throw;
         }
     }
-    void addStudent(int studentId, int lessonId) {
-        try {
-            if (lessonListLocation[lessonId] == -1)
-                throw "set classroom!";
-            conflictPersonLessonTime(lessonId, studentId);
-            lessonListStudentList[lessonId].push_back(studentId);
+    void waitlistStudent(int studentId, int lessonId, int priority = 0) {
+        checkJournal();
+        if (lessonListStudentList.find(lessonId) == lessonListStudentList.end())
+            throw "Couldn't Find Such a Lesson!";
+        if (lessonListStudentList.at(lessonId).count(studentId))
+            throw "Student is already enrolled!";
+        if (lessonWaitlist[lessonId].push(studentId, priority) && journal) {
+            ByteWriter w;
+            w.putI32(studentId);
+            w.putI32(lessonId);
+            w.putI32(priority);
+            journal->append(Journal::Op::waitlistStudent, w);
+        }
+    }
+    // Enrolls the student when there is a free seat and no conflict, otherwise puts them on the waitlist
+    bool requestSeat(int studentId, int lessonId, int priority = 0) {
+        checkJournal();
+        if (lessonListLocation.at(lessonId) == -1)
+            throw "set classroom!";
+        bool available = lessonListStudentList.at(lessonId).size() < static_cast<size_t>(getLesson(lessonId).getLessonMaxCapacity());
+        if (available) {
+            try {
+                conflictPersonLessonTime(lessonId, studentId);
+            }
+            catch (conflict_error&) {
+                available = false;
+            }
         }
-        catch (std::exception& e) {
-            throw e;
+        if (available) {
+            addStudent(studentId, lessonId);
+            return true;
         }
-        catch (char const* s) {
-            throw s;
+        waitlistStudent(studentId, lessonId, priority);
+        return false;
+    }
+    const Waitlist* getWaitlist(int lessonId) const {
+        auto it = lessonWaitlist.find(lessonId);
+        return it == lessonWaitlist.end() ? nullptr : &it->second;
+    }
+    void dropStudent(int studentId, int lessonId) {
+        checkJournal();
+        if (lessonListStudentList.at(lessonId).erase(studentId) == 0)
+            throw "Student is not enrolled in this Lesson!";
+        releasePerson(getLesson(lessonId), studentId);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(studentId);
+            w.putI32(lessonId);
+            journal->append(Journal::Op::dropStudent, w);
+        }
+        promote(lessonId);
+    }
+    void unassignTeacher(int lessonId) {
+        checkJournal();
+        int& teacher = lessonListTeacher.at(lessonId);
+        if (teacher == -1)
+            return;
+        releasePerson(getLesson(lessonId), teacher);
+        teacher = -1;
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            journal->append(Journal::Op::unassignTeacher, w);
+        }
+    }
+    // Enrolled students and the teacher keep the lesson; their timetables show it without a room
+    void unassignClassroom(int lessonId) {
+        checkJournal();
+        int& classroom = lessonListLocation.at(lessonId);
+        if (classroom == -1)
+            return;
+        releaseClassroom(getLesson(lessonId), classroom);
+        classroom = -1;
+        moveAttendees(lessonId, -1);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            journal->append(Journal::Op::unassignClassroom, w);
+        }
+    }
+    void removeLesson(int lessonId) {
+        checkJournal();
+        auto plain = lessonList.find(lessonId);
+        if (plain == lessonList.end())
+            throw "Couldn't Find Such a Lesson!";
+        const Lesson& lesson = getLesson(lessonId);
+        releaseClassroom(lesson, lessonListLocation.at(lessonId));
+        releasePerson(lesson, lessonListTeacher.at(lessonId));
+        for (int student: lessonListStudentList.at(lessonId))
+            releasePerson(lesson, student);
+        lessonListLocation.erase(lessonId);
+        lessonListTeacher.erase(lessonId);
+        lessonListStudentList.erase(lessonId);
+        lessonWaitlist.erase(lessonId);
+        lessonList.erase(plain);
+        extraLessonList.erase(lessonId);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(lessonId);
+            journal->append(Journal::Op::removeLesson, w);
+        }
+    }
+    void addStudent(int studentId, int lessonId) {
+        checkJournal();
+        enroll(studentId, lessonId);
+        if (journal) {
+            ByteWriter w;
+            w.putI32(studentId);
+            w.putI32(lessonId);
+            journal->append(Journal::Op::addStudent, w);
         }
     }
     void setTeacher(int teacherId, int lessonId) {
+        checkJournal();
         try {
             if (lessonListLocation[lessonId] == -1)
                 throw "set classroom!";
             if (!personList.getPersonInfo(teacherId).isTeacher())
                 throw "Person is not student!";
             conflictPersonLessonTime(lessonId, teacherId);
+            releasePerson(getLesson(lessonId), lessonListTeacher[lessonId]);
             lessonListTeacher[lessonId] = teacherId;
+            bookPerson(getLesson(lessonId), teacherId);
+            if (journal) {
+                ByteWriter w;
+                w.putI32(teacherId);
+                w.putI32(lessonId);
+                journal->append(Journal::Op::setTeacher, w);
+            }
         }
         catch (char const* s) {
             std::cout << s << std::endl;
@@ -771,22 +2746,32 @@ public:
 
     }
     void pushPersonList(const PersonList& newList) {
+        checkJournal();
         std::vector<Person> newPersonList = newList.getPersonList();
         while (!newPersonList.empty()) {
             auto newPerson = newPersonList.back();
-            personList.addPerson(newPerson);
+            if (personList.addPerson(newPerson) && journal) {
+                ByteWriter w;
+                w.putPerson(newPerson);
+                journal->append(Journal::Op::addPerson, w);
+            }
             newPersonList.pop_back();
         }
     }
     void pushLesson(const Lesson& lesson) {
+        checkJournal();
         try {
             if (lesson.getSession().empty())
                 throw "Session is Empty!";
-            std::vector<int> emptyStudentList;
-            lessonList.push_back(lesson);
+            insertLesson(lesson);
             lessonListLocation.insert(std::make_pair(lesson.getId(), -1));
             lessonListTeacher.insert(std::make_pair(lesson.getId(), -1));
-            lessonListStudentList.insert(std::make_pair(lesson.getId(), emptyStudentList));
+            lessonListStudentList.insert(std::make_pair(lesson.getId(), std::set<int>()));
+            if (journal) {
+                ByteWriter w;
+                w.putLesson(lesson);
+                journal->append(Journal::Op::pushLesson, w);
+            }
         }
         catch (char const* s) {
             throw;
@@ -797,15 +2782,22 @@ public:
 
     }
     void pushExtraLesson(const ExtraLesson& lesson) {
+        checkJournal();
         try {
             if (lesson.getSession().empty())
                 throw "Session is Empty!";
-            std::vector<int> emptyStudentList;
-            lessonList.push_back(lesson);
-            extraLessonList.push_back(lesson);
+            insertLesson(lesson);
+            extraLessonList.emplace(lesson.getId(), lesson);
             lessonListLocation.insert(std::make_pair(lesson.getId(), -1));
             lessonListTeacher.insert(std::make_pair(lesson.getId(), -1));
-            lessonListStudentList.insert(std::make_pair(lesson.getId(), emptyStudentList));
+            lessonListStudentList.insert(std::make_pair(lesson.getId(), std::set<int>()));
+            if (journal) {
+                ByteWriter w;
+                w.putDate(lesson.getStart());
+                w.putDate(lesson.getEnd());
+                w.putLesson(lesson);
+                journal->append(Journal::Op::pushExtraLesson, w);
+            }
         }
         catch (char const* s) {
             throw;
@@ -815,32 +2807,273 @@ public:
         }
 
     }
-    void printLessonSpecs(int lessonId) const {
-        std::cout << "\n\n::::::::::::::::::: COURSE INFO :::::::::::::::::::\n";
+    void exportXml(const std::string& path) const {
+        FILE* file = fopen(path.c_str(), "w");
+        if (!file)
+            throw "Couldn't Write XML File!";
+        struct FileSink : tinyxml2::XMLSink {
+            FILE* file;
+            bool ok = true;
+            explicit FileSink(FILE* file) : file(file) {}
+            void Write(const char* data, size_t size) override {
+                ok = fwrite(data, 1, size, file) == size && ok;
+            }
+        } sink(file);
+        tinyxml2::XMLPrinter printer(sink);
+        printer.PushHeader(false, true);
+        printer.OpenElement("term");
+        printer.PushAttribute("startYear", start.getYear());
+        printer.PushAttribute("startMonth", start.getMonth());
+        printer.PushAttribute("startDay", start.getDay());
+        printer.PushAttribute("endYear", end.getYear());
+        printer.PushAttribute("endMonth", end.getMonth());
+        printer.PushAttribute("endDay", end.getDay());
+        printer.OpenElement("classrooms");
+        for (const auto& c: classroomList.getList()) {
+            printer.OpenElement("classroom");
+            printer.PushAttribute("number", c.getNumber());
+            printer.PushAttribute("capacity", c.getCapacity());
+            printer.PushAttribute("projector", c.isProjector());
+            const auto& names = classroomList.getFeatures().list();
+            for (size_t i = 1; i < names.size(); i++)
+                if (c.getFeatures() & (FeatureMask(1) << i))
+                    printer.PushAttribute(names[i].c_str(), true);
+            printer.CloseElement();
+        }
+        printer.CloseElement();
+        printer.OpenElement("people");
+        for (const auto& p: personList.getPersonList()) {
+            printer.OpenElement("person");
+            printer.PushAttribute("id", p.getId());
+            printer.PushAttribute("name", p.getName().c_str());
+            printer.PushAttribute("teacher", p.isTeacher());
+            printer.CloseElement();
+        }
+        printer.CloseElement();
+        printer.OpenElement("lessons");
+        for (const auto& plain: lessonList) {
+            const Lesson& lesson = getLesson(plain.first);
+            printer.OpenElement("lesson");
+            printer.PushAttribute("id", lesson.getId());
+            printer.PushAttribute("name", lesson.getName().c_str());
+            printer.PushAttribute("capacity", lesson.getLessonMaxCapacity());
+            printer.PushAttribute("projector", lesson.getNeedProjector());
+            printer.PushAttribute("classroom", lessonListLocation.at(lesson.getId()));
+            printer.PushAttribute("teacher", lessonListTeacher.at(lesson.getId()));
+            if (const auto* extra = dynamic_cast<const ExtraLesson*>(&lesson)) {
+                printer.PushAttribute("extra", true);
+                printer.PushAttribute("startYear", extra->getStart().getYear());
+                printer.PushAttribute("startMonth", extra->getStart().getMonth());
+                printer.PushAttribute("startDay", extra->getStart().getDay());
+                printer.PushAttribute("endYear", extra->getEnd().getYear());
+                printer.PushAttribute("endMonth", extra->getEnd().getMonth());
+                printer.PushAttribute("endDay", extra->getEnd().getDay());
+            }
+            for (const auto& feature: lesson.getRequiredFeatures())
+                if (feature != "projector") {
+                    printer.OpenElement("requires");
+                    printer.PushAttribute("feature", feature.c_str());
+                    printer.CloseElement();
+                }
+            for (const auto& s: lesson.getSession()) {
+                printer.OpenElement("session");
+                printer.PushAttribute("day", dayName(s.first.getDay()));
+                printer.PushAttribute("hour", s.first.getTime().getHour());
+                printer.PushAttribute("minute", s.first.getTime().getMin());
+                printer.PushAttribute("duration", s.second);
+                printer.CloseElement();
+            }
+            for (int student: lessonListStudentList.at(lesson.getId())) {
+                printer.OpenElement("student");
+                printer.PushAttribute("id", student);
+                printer.CloseElement();
+            }
+            printer.CloseElement();
+        }
+        printer.CloseElement();
+        printer.CloseElement();
+        printer.Flush();
+        bool ok = fflush(file) == 0 && sink.ok;
+        fclose(file);
+        if (!ok)
+            throw "Couldn't Write XML File!";
+    }
+    static LessonList importXml(const std::string& path) {
+        // the export is read as a stream, a piece at a time (it can also come from a pipe). The term is
+        // made once </classrooms> closes, and every person and lesson joins it as soon as it has been parsed
+        struct TermReader : tinyxml2::XMLVisitor {
+            bool root = false;
+            int range[6] = {};
+            std::vector<Classroom> classrooms;
+            Features features;
+            std::optional<LessonList> term;
+            // thrown once the parser has stopped, so it never unwinds through the parser
+            std::exception_ptr failure;
+
+            static Date date(const tinyxml2::XMLElement& elem, const char* year, const char* month, const char* day) {
+                return Date(elem.IntAttribute(day), elem.IntAttribute(month), elem.IntAttribute(year));
+            }
+            static bool under(const tinyxml2::XMLElement& elem, const char* list) {
+                const tinyxml2::XMLElement* parent = elem.Parent() ? elem.Parent()->ToElement() : nullptr;
+                return parent && std::strcmp(parent->Name(), list) == 0;
+            }
+            LessonList& list() {
+                if (!term)
+                    term.emplace(LessonList(ClassroomList(classrooms, features), Date(range[2], range[1], range[0]), Date(range[5], range[4], range[3])));
+                return *term;
+            }
+            bool VisitEnter(const tinyxml2::XMLElement& elem, const tinyxml2::XMLAttribute*) override {
+                if (failure)
+                    return false;
+                const char* name = elem.Name();
+                if (!elem.Parent()->ToElement()) {
+                    root = std::strcmp(name, "term") == 0;
+                    const char* keys[6] = {"startYear", "startMonth", "startDay", "endYear", "endMonth", "endDay"};
+                    for (int i = 0; i < 6 && root; i++)
+                        range[i] = elem.IntAttribute(keys[i]);
+                    return root;
+                }
+                try {
+                    if (std::strcmp(name, "classroom") == 0 && under(elem, "classrooms")) {
+                        if (term)
+                            throw "Error loading XML file.";
+                        classrooms.push_back(ClassroomList::fromElement(&elem, features));
+                    }
+                    else if (std::strcmp(name, "person") == 0 && under(elem, "people"))
+                        list().personList.addPerson(Person(elem.Attribute("name") ? elem.Attribute("name") : "", elem.IntAttribute("id"), elem.BoolAttribute("teacher")));
+                    else if (std::strcmp(name, "lesson") == 0 && under(elem, "lessons"))
+                        readLesson(elem);
+                    else
+                        return true;
+                }
+                catch (...) {
+                    failure = std::current_exception();
+                }
+                return false;
+            }
+            bool VisitExit(const tinyxml2::XMLElement& elem) override {
+                if (!failure && std::strcmp(elem.Name(), "classrooms") == 0 && under(elem, "term")) {
+                    try {
+                        list();
+                    }
+                    catch (...) {
+                        failure = std::current_exception();
+                    }
+                }
+                return true;
+            }
+            void readLesson(const tinyxml2::XMLElement& elem) {
+                ExtraLesson lesson(elem.IntAttribute("id"), elem.Attribute("name") ? elem.Attribute("name") : "", elem.IntAttribute("capacity"),
+                                   date(elem, "startYear", "startMonth", "startDay"), date(elem, "endYear", "endMonth", "endDay"), elem.BoolAttribute("projector"));
+                for (const auto* r = elem.FirstChildElement("requires"); r; r = r->NextSiblingElement("requires"))
+                    if (r->Attribute("feature"))
+                        lesson.requireFeature(r->Attribute("feature"));
+                for (const auto* s = elem.FirstChildElement("session"); s; s = s->NextSiblingElement("session")) {
+                    const char* name = s->Attribute("day");
+                    int d = 0;
+                    while (d < 7 && !(name && std::strcmp(dayName(static_cast<Day>(d)), name) == 0))
+                        d++;
+                    if (d == 7)
+                        throw "Error loading XML file.";
+                    lesson.addSession(WeekTime(static_cast<Day>(d), Time(s->IntAttribute("hour"), s->IntAttribute("minute"))), s->IntAttribute("duration"));
+                }
+                std::set<int> students;
+                for (const auto* s = elem.FirstChildElement("student"); s; s = s->NextSiblingElement("student"))
+                    students.insert(s->IntAttribute("id"));
+                if (elem.BoolAttribute("extra"))
+                    list().restoreLesson(lesson, elem.IntAttribute("classroom", -1), elem.IntAttribute("teacher", -1), std::move(students));
+                else
+                    list().restoreLesson(Lesson(lesson), elem.IntAttribute("classroom", -1), elem.IntAttribute("teacher", -1), std::move(students));
+            }
+        };
+
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file)
+            throw "Error loading XML file.";
+        TermReader reader;
+        tinyxml2::XMLPushParser parser(&reader, 2);
+        std::vector<char> chunk(64 * 1024);
+        size_t size;
+        while ((size = fread(chunk.data(), 1, chunk.size(), file)) > 0 && parser.Feed(chunk.data(), size) == tinyxml2::XML_SUCCESS && !reader.failure)
+            ;
+        bool ok = !ferror(file) && (reader.failure || parser.Finish() == tinyxml2::XML_SUCCESS);
+        fclose(file);
+        if (reader.failure)
+            std::rethrow_exception(reader.failure);
+        if (!ok)
+            throw "Error loading XML file.";
+        if (!reader.root)
+            throw "Error finding root element in XML file.";
+        return std::move(reader.list());
+    }
+    void renderLessonSpecs(int lessonId, ReportWriter& out) const {
+        out << "\n\n::::::::::::::::::: COURSE INFO :::::::::::::::::::\n";
         const auto& temp = getLesson(lessonId);
-        temp.printLesson();
+        temp.renderLesson(out);
         int classroom = lessonListLocation.at(lessonId);
-        classroomList.getClassroomInfo(classroom).printClassroomSpecs();
+        classroomList.findClassroom(classroom).renderClassroomSpecs(out);
         int teacher = lessonListTeacher.at(lessonId);
-        std::cout << "Teacher:  ";
-        (personList.getPersonInfo(teacher)).printPerson();
-        std::cout << "Students: " << std::endl;
+        out << "Teacher:  ";
+        personList.findPerson(teacher).renderPerson(out);
+        out << "Students: " << '\n';
         for (int student: lessonListStudentList.at(lessonId)) {
-            std::cout << "  ";
-            (personList.getPersonInfo(student)).printPerson();
+            out << "  ";
+            personList.findPerson(student).renderPerson(out);
         }
-        std::cout << "::::::::::::::::: END COURSE INFO :::::::::::::::::\n";
+        out << "::::::::::::::::: END COURSE INFO :::::::::::::::::\n";
     }
-    void printTermSpecs() const {
-        std::cout << ":::::::::::::::::::::::::::::::: TERM INFO ::::::::::::::::::::::::::::::::" << std::endl;
-        std::cout << "Term Range: From " << start.dateToString() << " To " << end.dateToString();
-        for(auto const& lesson : lessonList) {
-            printLessonSpecs(lesson.getId());
+    void renderTermSpecs(ReportWriter& out, unsigned threads = 1) const {
+        out << ":::::::::::::::::::::::::::::::: TERM INFO ::::::::::::::::::::::::::::::::" << '\n';
+        out << "Term Range: From " << start << " To " << end;
+        if (threads <= 1 || lessonList.size() < 2) {
+            for(auto const& lesson : lessonList) {
+                renderLessonSpecs(lesson.first, out);
+            }
+        }
+        else {
+            // every lesson block is rendered into its own buffer and the blocks are written in lesson order,
+            // so the output is the same as the sequential one; a failing block stops the report where it would have
+            std::vector<int> ids;
+            for (const auto& lesson: lessonList)
+                ids.push_back(lesson.first);
+            std::vector<std::string> blocks(ids.size());
+            std::vector<std::exception_ptr> errors(ids.size());
+            std::atomic<size_t> next(0);
+            auto worker = [&]() {
+                for (size_t i = next++; i < ids.size(); i = next++) {
+                    ReportWriter block([&blocks, i](const char* data, size_t size) { blocks[i].append(data, size); });
+                    try {
+                        renderLessonSpecs(ids[i], block);
+                    }
+                    catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            };
+            std::vector<std::thread> pool;
+            for (unsigned t = 0; t < std::min<size_t>(threads, ids.size()); t++)
+                pool.emplace_back(worker);
+            for (auto& t: pool)
+                t.join();
+            for (size_t i = 0; i < blocks.size(); i++) {
+                out.write(blocks[i].data(), blocks[i].size());
+                if (errors[i])
+                    std::rethrow_exception(errors[i]);
+            }
         }
-        std::cout << "\n:::::::::::::::::::::::::::::: END TERM INFO ::::::::::::::::::::::::::::::" << std::endl;
+        out << "\n:::::::::::::::::::::::::::::: END TERM INFO ::::::::::::::::::::::::::::::" << '\n';
+    }
+    void printLessonSpecs(int lessonId) const {
+        ReportWriter out;
+        renderLessonSpecs(lessonId, out);
+    }
+    void printTermSpecs(unsigned threads = 1) const {
+        ReportWriter out(ReportWriter::toStdout, 1 << 20);
+        renderTermSpecs(out, threads);
     }
 };
 
+#ifndef COURSE_NO_MAIN
 int main()
 {
     try {
@@ -1078,10 +3311,19 @@ int main()
         std::cout << s << std::endl;
     }
 }
+#endif
 
 /*
  * Documentation
- * 1. You are not allow to add session after assigning student or teacher
+ * 1. Sessions can be added or removed after assigning student or teacher; only the changed session is re-checked
  * 2. GitHub Address: https://github.com/mahdimahdieh/qtCourse
+ * 3. Attach a Journal to a term to log every mutation; replayJournal rebuilds the term after a crash
+ * 4. writeSnapshot saves the whole term; TermSnapshot maps it back read-only and LessonList(snapshot) resumes it
+ * 5. exportXml / importXml save and load the whole term as XML; importXml reads the file as a stream, so it can be a pipe; exportXml writes through a 64k buffer
+ * 6. getTimetable returns a person's weekly schedule, kept up to date on every assignment
+ * 7. computeStats reports classroom utilization, seat efficiency, projector room misuse and teacher hours
+ * 8. A full lesson does not accept more students; requestSeat waitlists them and dropStudent promotes the next one
+ * 9. unassignTeacher, unassignClassroom and removeLesson undo assignments; a classroom can be changed after people are assigned
+ * 10. A classroom attribute set to "true" in class.xml is a feature of that term's rooms; a lesson can require features besides the projector
  *
  */
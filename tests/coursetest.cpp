@@ -0,0 +1,752 @@
+// Tests for the term's persistence, queries and scheduling. Most build a term, save or
+// change it, and check the result against the term printed before.
+
+#define COURSE_NO_MAIN
+#include "../main.cpp"
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+static int passed = 0;
+static int failed = 0;
+
+static bool check(const char* name, const std::string& expected, const std::string& found) {
+    if (expected == found) {
+        ++passed;
+        return true;
+    }
+    ++failed;
+    std::cout << "[fail] " << name << "\n  expected: " << expected.substr(0, 200) << "\n  found:    " << found.substr(0, 200) << std::endl;
+    return false;
+}
+
+static bool check(const char* name, long long expected, long long found) {
+    return check(name, std::to_string(expected), std::to_string(found));
+}
+
+static std::string specs(const LessonList& term) {
+    std::string text;
+    {
+        ReportWriter out([&text](const char* data, size_t size) { text.append(data, size); });
+        term.renderTermSpecs(out);
+    }
+    return text;
+}
+
+static std::string lessonsOf(const LessonList& term, int personId) {
+    std::string ids;
+    for (int lessonId: term.getLessonListOfPerson(personId))
+        ids += std::to_string(lessonId) + " ";
+    return ids;
+}
+
+static void writeFile(const char* path, const std::string& text) {
+    FILE* file = fopen(path, "wb");
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+}
+
+// Two students and a teacher in a lesson and an extra lesson, both with classrooms.
+static void fillTerm(LessonList& term) {
+    PersonList people;
+    people.addPerson(Person("A", 1));
+    people.addPerson(Person("B", 2));
+    people.addPerson(Person("T", 3, true));
+    term.pushPersonList(people);
+    Lesson lesson(10, "X", 20, true);
+    lesson.addSession(WeekTime(Day::sun, Time(9, 0)), 90);
+    term.pushLesson(lesson);
+    ExtraLesson extra(12, "E", 10, Date(1, 2, 2024), Date(2, 2, 2024));
+    extra.addSession(WeekTime(Day::mon, Time(10, 0)), 30);
+    term.pushExtraLesson(extra);
+    term.addSession(10, WeekTime(Day::tue, Time(8, 0)), 60);
+    term.setClassroom(10, 1);
+    term.setClassroom(12, term.findEmptyClass(12));
+    term.setTeacher(3, 10);
+    term.setTeacher(3, 12);
+    term.addStudent(1, 10);
+    term.addStudent(2, 10);
+    term.addStudent(1, 12);
+}
+
+// Replaying a journal rebuilds the term, past a torn last record and after the journal
+// has been reopened and its torn tail cut off.
+static void testJournal() {
+    remove("test.journal");
+    std::string expected;
+    {
+        Journal journal("test.journal", 4);
+        LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+        term.attachJournal(&journal);
+        fillTerm(term);
+        expected = specs(term);
+    }
+    FILE* file = fopen("test.journal", "ab");
+    fwrite("\x05\x00\x00", 1, 3, file);
+    fclose(file);
+
+    LessonList replayed(Date(1, 1, 2024), Date(1, 6, 2024));
+    replayed.replayJournal("test.journal");
+    check("Journal replay past a torn tail", expected, specs(replayed));
+
+    { Journal reopened("test.journal"); }
+    LessonList truncated(Date(1, 1, 2024), Date(1, 6, 2024));
+    truncated.replayJournal("test.journal");
+    check("Journal replay after reopening", expected, specs(truncated));
+
+    file = fopen("test.journal", "wb");
+    fputs("not a journal at all", file);
+    fclose(file);
+    std::string error;
+    try {
+        LessonList other(Date(1, 1, 2024), Date(1, 6, 2024));
+        other.replayJournal("test.journal");
+    }
+    catch (char const* s) {
+        error = s;
+    }
+    check("Journal without a header", "Not a Journal!", error);
+    remove("test.journal");
+}
+
+#ifndef _WIN32
+static long fileSize(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? static_cast<long>(st.st_size) : -1;
+}
+
+static void limitFileSize(rlim_t size) {
+    rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    limit.rlim_cur = size;
+    setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+// A write that fails halfway is cut off the file and retried whole, and a mutator called after
+// the failure throws before it changes the term, so the term replays as it was left.
+static void testJournalFailure() {
+    remove("test.journal");
+    signal(SIGXFSZ, SIG_IGN);
+    rlimit original;
+    getrlimit(RLIMIT_FSIZE, &original);
+    std::string expected;
+    {
+        Journal journal("test.journal", 1000, 60000);
+        LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+        term.attachJournal(&journal);
+        PersonList people;
+        for (int i = 1; i <= 3; i++)
+            people.addPerson(Person("S", i));
+        people.addPerson(Person("T", 4, true));
+        term.pushPersonList(people);
+        Lesson lesson(10, "X", 1);
+        lesson.addSession(WeekTime(Day::sun, Time(9, 0)), 90);
+        term.pushLesson(lesson);
+        term.setClassroom(10, 1);
+        term.setTeacher(4, 10);
+        journal.commit();
+        const long size = fileSize("test.journal");
+
+        limitFileSize(size + 10);
+        term.addStudent(1, 10);
+        term.requestSeat(2, 10);
+        std::string error;
+        try {
+            journal.commit();
+        }
+        catch (char const* s) {
+            error = s;
+        }
+        check("Failed write throws from commit", "Couldn't Write Journal!", error);
+        check("Failed write is cut off the file", size, fileSize("test.journal"));
+
+        const std::string before = specs(term);
+        error.clear();
+        try {
+            term.dropStudent(1, 10);
+        }
+        catch (char const* s) {
+            error = s;
+        }
+        check("Mutator throws a failed write", "Couldn't Write Journal!", error);
+        check("Mutator leaves the term alone after a failed write", before, specs(term));
+
+        setrlimit(RLIMIT_FSIZE, &original);
+        term.dropStudent(1, 10);
+        journal.commit();
+        expected = specs(term) + lessonsOf(term, 2);
+    }
+    LessonList replayed(Date(1, 1, 2024), Date(1, 6, 2024));
+    replayed.replayJournal("test.journal");
+    check("Replay after a failed write", expected, specs(replayed) + lessonsOf(replayed, 2));
+    remove("test.journal");
+}
+#endif
+
+// A term mapped back from its snapshot prints the same as the term written.
+static void testSnapshot() {
+    LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+    fillTerm(term);
+    term.writeSnapshot("test.snap");
+    {
+        TermSnapshot snapshot("test.snap");
+        LessonList restored(snapshot);
+        check("Snapshot round trip", specs(term), specs(restored));
+        check("Snapshot person name", "T", std::string(snapshot.name(*snapshot.findPerson(3))));
+        check("Snapshot extra lesson", 1, snapshot.findLesson(12)->extra);
+    }
+
+    // records with values out of range are refused before anything reads them
+    std::string file;
+    {
+        FILE* in = fopen("test.snap", "rb");
+        char chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+            file.append(chunk, n);
+        fclose(in);
+    }
+    TermSnapshot::Header h;
+    std::memcpy(&h, file.data(), sizeof(h));
+    using Record = TermSnapshot::LessonRecord;
+    const struct {
+        const char* name;
+        size_t offset;
+        int32_t value;
+        size_t size;
+    } corruptions[] = {
+        {"Snapshot session day out of range", h.sessionOffset + offsetof(TermSnapshot::SessionRecord, day), 7, 1},
+        {"Snapshot session duration out of range", h.sessionOffset + offsetof(TermSnapshot::SessionRecord, duration), MAX_SESSION_DURATION_MINUTES + 1, 4},
+        {"Snapshot unknown classroom", h.lessonOffset + offsetof(Record, classroom), 41, 4},
+        {"Snapshot unknown teacher", h.lessonOffset + offsetof(Record, teacher), 99, 4},
+        {"Snapshot unknown student", h.studentOffset, 99, 4},
+        {"Snapshot unknown feature", h.lessonOffset + offsetof(Record, features), 1 << 20, 4},
+    };
+    for (const auto& c: corruptions) {
+        std::string corrupt = file;
+        std::memcpy(&corrupt[c.offset], &c.value, c.size);
+        writeFile("test.snap", corrupt);
+        std::string error;
+        try {
+            TermSnapshot snapshot("test.snap");
+        }
+        catch (char const* s) {
+            error = s;
+        }
+        check(c.name, "Corrupt Snapshot!", error);
+    }
+    remove("test.snap");
+}
+
+// A term imported from its XML export prints the same, with names that need escaping.
+static void testXml() {
+    LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+    fillTerm(term);
+    PersonList people;
+    people.addPerson(Person("Sara \"Q\" & <Co>", 4));
+    term.pushPersonList(people);
+    term.addStudent(4, 10);
+    term.exportXml("test.xml");
+    LessonList imported = LessonList::importXml("test.xml");
+    check("XML round trip", specs(term), specs(imported));
+
+    const std::string head = "<term startYear='2024' startMonth='1' startDay='1' endYear='2024' endMonth='6' endDay='1'>"
+                             "<classrooms><classroom number='1' capacity='20'/></classrooms><people/><lessons>";
+    const char* sessions[] = {"<session day='Someday' hour='9' minute='0' duration='60'/>", "<session hour='9' minute='0' duration='60'/>"};
+    for (const char* session: sessions) {
+        writeFile("test.xml", head + "<lesson id='1' name='X' capacity='10'>" + session + "</lesson></lessons></term>");
+        std::string error;
+        try {
+            LessonList::importXml("test.xml");
+        }
+        catch (char const* s) {
+            error = s;
+        }
+        check("XML session without a known day", "Error loading XML file.", error);
+    }
+    remove("test.xml");
+}
+
+static std::string emptyClass(const LessonList& term, int lessonId) {
+    try {
+        return std::to_string(term.findEmptyClass(lessonId));
+    }
+    catch (char const* s) {
+        return s;
+    }
+}
+
+static std::string featureNames(const LessonList& term) {
+    std::string names;
+    for (const auto& name: term.getClassroomList().getFeatures().list())
+        names += name + " ";
+    return names;
+}
+
+// Only attributes set to "true" are features; a lesson fits the rooms that have all it requires,
+// also after a snapshot. Each term keeps its own feature names.
+static void testFeatures() {
+    const std::string head = "<term startYear='2024' startMonth='1' startDay='1' endYear='2024' endMonth='6' endDay='1'><classrooms>";
+    writeFile("test.xml", head +
+              "<classroom number='3' capacity='20' projector='false' floor='2' seats='10' lab='true'/>"
+              "<classroom number='4' capacity='30' projector='true' lab='false' ramp='yes'/>"
+              "</classrooms><people/><lessons/></term>");
+    LessonList term = LessonList::importXml("test.xml");
+    check("Features are the attributes set to true", "projector lab ", featureNames(term));
+    check("Room with a true attribute", 2, term.getClassroomList().findClassroom(3).getFeatures());
+    check("Room with a projector", 1, term.getClassroomList().findClassroom(4).getFeatures());
+
+    Lesson lab(1, "Lab", 10);
+    lab.requireFeature("lab");
+    lab.addSession(WeekTime(Day::sun, Time(9, 0)), 60);
+    term.pushLesson(lab);
+    Lesson upstairs(2, "Upstairs", 10);
+    upstairs.requireFeature("floor");
+    upstairs.addSession(WeekTime(Day::sun, Time(9, 0)), 60);
+    term.pushLesson(upstairs);
+    Lesson slides(3, "Slides", 10, true);
+    slides.addSession(WeekTime(Day::sun, Time(9, 0)), 60);
+    term.pushLesson(slides);
+    check("Lesson goes to the room with its feature", "3", emptyClass(term, 1));
+    check("Feature no room has fits nowhere", "There is no Empty Class", emptyClass(term, 2));
+    check("Projector lesson goes to the projector room", "4", emptyClass(term, 3));
+    term.setClassroom(2, 3);
+    check("Room without the feature is not set", 0, term.getPlannedLessonOnClassroom(3).size());
+
+    term.writeSnapshot("test.snap");
+    {
+        TermSnapshot snapshot("test.snap");
+        LessonList restored(snapshot);
+        check("Snapshot keeps room features", "projector lab ", featureNames(restored));
+        check("Snapshot keeps lesson features", "3 There is no Empty Class", emptyClass(restored, 1) + " " + emptyClass(restored, 2));
+    }
+    remove("test.snap");
+
+    // names seen by other terms do not use up the bits of a new one
+    for (int i = 0; i < 40; i++) {
+        writeFile("test.xml", head + "<classroom number='1' capacity='20' f" + std::to_string(i) + "='true'/></classrooms></term>");
+        LessonList::importXml("test.xml");
+    }
+    remove("test.xml");
+    LessonList fresh(Date(1, 1, 2024), Date(1, 6, 2024));
+    check("New term has only its own features", "projector ", featureNames(fresh));
+    fresh.pushLesson(lab);
+    check("Feature of another term fits nowhere", "There is no Empty Class", emptyClass(fresh, 1));
+}
+
+static bool hasRoom(const std::vector<Classroom>& rooms, int number) {
+    return std::find(rooms.begin(), rooms.end(), Classroom(number)) != rooms.end();
+}
+
+// The free-room query leaves out rooms that are too small, lack a feature or hold a session
+// overlapping any slot, and follows a lesson to its new room.
+static void testFreeClassrooms() {
+    LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+    Lesson a(10, "X", 20, true);
+    a.addSession(WeekTime(Day::tue, Time(13, 0)), 120);
+    term.pushLesson(a);
+    term.setClassroom(10, 1);
+    Lesson b(11, "Y", 20);
+    b.addSession(WeekTime(Day::tue, Time(14, 30)), 60);
+    term.pushLesson(b);
+    term.setClassroom(11, 3);
+    term.addSession(11, WeekTime(Day::sun, Time(9, 0)), 30);
+
+    int large = 0;
+    for (const Classroom& room: term.getClassroomList().getList())
+        large += room.getCapacity() >= 30 && room.isProjector();
+    auto rooms = term.findFreeClassrooms({{WeekTime(Day::tue, Time(13, 0)), 120}}, 30, Features::PROJECTOR);
+    check("Free rooms by capacity and projector", large - 1, rooms.size());
+    check("Overlapped room is not free", 0, hasRoom(rooms, 3));
+    for (const Classroom& room: rooms)
+        if (room.getCapacity() < 30 || !room.isProjector())
+            check("Free room fits the lesson", 0, room.getNumber());
+
+    rooms = term.findFreeClassrooms({{WeekTime(Day::tue, Time(15, 0)), 30}});
+    check("Room busy until its session ends", 0, hasRoom(rooms, 3));
+    check("Room free once its session ends", 1, hasRoom(rooms, 1));
+    check("Free rooms in a busy hour", term.getClassroomList().getList().size() - 1, rooms.size());
+
+    rooms = term.findFreeClassrooms({{WeekTime(Day::sun, Time(9, 10)), 10}});
+    check("Added session occupies its room", 0, hasRoom(rooms, 3));
+    term.setClassroom(11, 8);
+    rooms = term.findFreeClassrooms({{WeekTime(Day::sun, Time(9, 10)), 10}});
+    check("Old room freed by a move", 1, hasRoom(rooms, 3));
+    check("New room occupied by a move", 0, hasRoom(rooms, 8));
+}
+
+// A dropped seat goes to the highest priority waiting student without a conflict, both live
+// and on replay; without a classroom the waitlist is kept for later.
+static void testWaitlist() {
+    remove("test.journal");
+    {
+        Journal journal("test.journal");
+        LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+        term.attachJournal(&journal);
+        PersonList people;
+        for (int i = 1; i <= 5; i++)
+            people.addPerson(Person("S", i));
+        term.pushPersonList(people);
+        Lesson a(10, "X", 2);
+        a.addSession(WeekTime(Day::tue, Time(13, 0)), 60);
+        term.pushLesson(a);
+        term.setClassroom(10, 1);
+        Lesson b(11, "Y", 5);
+        b.addSession(WeekTime(Day::tue, Time(13, 30)), 60);
+        term.pushLesson(b);
+        term.setClassroom(11, 2);
+
+        std::string seats;
+        seats += term.requestSeat(1, 10) ? 'y' : 'n';
+        seats += term.requestSeat(2, 10) ? 'y' : 'n';
+        seats += term.requestSeat(3, 10) ? 'y' : 'n';
+        seats += term.requestSeat(4, 10, 5) ? 'y' : 'n';
+        seats += term.requestSeat(5, 10) ? 'y' : 'n';
+        check("Seats until the lesson is full", "yynnn", seats);
+        // 4 waits first but now conflicts with lesson 10, so 3 gets the seat
+        term.addStudent(4, 11);
+        term.dropStudent(1, 10);
+        check("Dropped seat skips a conflicting student", "10 ", lessonsOf(term, 3));
+        check("Conflicting student leaves the waitlist", "11 ", lessonsOf(term, 4));
+        check("Still waiting after a promotion", 1, term.getWaitlist(10)->size());
+    }
+    LessonList replayed(Date(1, 1, 2024), Date(1, 6, 2024));
+    replayed.replayJournal("test.journal");
+    check("Replayed promotion", "10 ", lessonsOf(replayed, 3));
+    check("Replayed waitlist", 1, replayed.getWaitlist(10)->size());
+    remove("test.journal");
+
+    LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+    PersonList people;
+    people.addPerson(Person("A", 1));
+    people.addPerson(Person("B", 2));
+    term.pushPersonList(people);
+    Lesson lesson(10, "X", 1);
+    lesson.addSession(WeekTime(Day::sun, Time(9, 0)), 90);
+    term.pushLesson(lesson);
+    term.setClassroom(10, 1);
+    term.addStudent(1, 10);
+    check("Full lesson waitlists", 0, term.requestSeat(2, 10));
+    term.unassignClassroom(10);
+    term.dropStudent(1, 10);
+    check("No promotion without a classroom", 1, term.getWaitlist(10)->size());
+    check("Waiting student not enrolled", "", lessonsOf(term, 2));
+    term.setClassroom(10, 1);
+    check("Promotion when a classroom is set", "10 ", lessonsOf(term, 2));
+    check("Waitlist empty after promotion", 0, term.getWaitlist(10)->size());
+
+    check("Full lesson waitlists again", 0, term.requestSeat(1, 10));
+    term.unassignClassroom(10);
+    term.dropStudent(2, 10);
+    term.assignClassrooms({{10, 1}});
+    check("Promotion when classrooms are assigned", "10 ", lessonsOf(term, 1));
+}
+
+// Random lessons, each put in the last free room that fits, which is rarely the tightest.
+static void fillRandomTerm(LessonList& term, int lessons) {
+    std::mt19937 rng(3);
+    for (int l = 0; l < lessons; l++) {
+        Lesson lesson(l, "L", 5 + rng() % 36, rng() % 3 == 0);
+        int sessions = 1 + rng() % 2;
+        for (int k = 0; k < sessions; k++) {
+            try {
+                lesson.addSession(WeekTime(static_cast<Day>(rng() % 7), Time(7 + rng() % 12, 0)), 60 + 30 * (rng() % 3));
+            }
+            catch (conflict_error&) {
+            }
+        }
+        term.pushLesson(lesson);
+        std::vector<std::pair<WeekTime, int>> slots(lesson.getSession().begin(), lesson.getSession().end());
+        auto rooms = term.findFreeClassrooms(slots, lesson.getLessonMaxCapacity(), term.getClassroomList().getFeatures().mask(lesson.getRequiredFeatures()));
+        if (!rooms.empty())
+            term.setClassroom(l, rooms.back().getNumber());
+    }
+}
+
+static std::string assignment(const LessonList& term) {
+    std::string rooms;
+    for (const Classroom& room: term.getClassroomList().getList()) {
+        rooms += std::to_string(room.getNumber()) + ":";
+        for (int lessonId: term.getPlannedLessonOnClassroom(room.getNumber()))
+            rooms += std::to_string(lessonId) + ",";
+        rooms += " ";
+    }
+    return rooms;
+}
+
+// Every room holds only lessons it fits, at times that do not overlap.
+static int invalidRooms(const LessonList& term) {
+    int invalid = 0;
+    for (const Classroom& room: term.getClassroomList().getList()) {
+        auto lessons = term.getPlannedLessonOnClassroom(room.getNumber());
+        bool valid = true;
+        for (size_t a = 0; a < lessons.size(); a++) {
+            const Lesson& lesson = term.getLesson(lessons[a]);
+            if (lesson.getLessonMaxCapacity() > room.getCapacity() || !room.hasFeatures(term.getClassroomList().getFeatures().mask(lesson.getRequiredFeatures())))
+                valid = false;
+            for (size_t b = a + 1; b < lessons.size(); b++) {
+                try {
+                    lesson.conflictLessonTime(term.getLesson(lessons[b]));
+                }
+                catch (conflict_error&) {
+                    valid = false;
+                }
+            }
+        }
+        invalid += !valid;
+    }
+    return invalid;
+}
+
+static int assignedLessons(const LessonList& term) {
+    int assigned = 0;
+    for (const Classroom& room: term.getClassroomList().getList())
+        assigned += static_cast<int>(term.getPlannedLessonOnClassroom(room.getNumber()).size());
+    return assigned;
+}
+
+// The optimizer lowers the wasted seats of a greedy assignment, keeps every lesson placed and
+// every room valid, and gives the same rooms for the same seed whatever the thread timing.
+static void testOptimizer() {
+    const int lessons = 200;
+    LessonList greedy(Date(1, 1, 2024), Date(1, 6, 2024));
+    fillRandomTerm(greedy, lessons);
+    const int assigned = assignedLessons(greedy);
+    ClassroomOptimizer::Options options;
+    options.threads = 4;
+    options.seed = 9;
+    options.iterations = 0;
+    options.budget = std::chrono::milliseconds(60000);
+    const long long before = greedy.optimizeClassrooms(options);
+
+    options.iterations = 20000;
+    LessonList first(Date(1, 1, 2024), Date(1, 6, 2024)), second(Date(1, 1, 2024), Date(1, 6, 2024));
+    fillRandomTerm(first, lessons);
+    fillRandomTerm(second, lessons);
+    const long long after = first.optimizeClassrooms(options);
+    second.optimizeClassrooms(options);
+    check("Optimizer lowers the cost", 1, after < before);
+    check("Optimizer keeps lessons placed", 1, assignedLessons(first) >= assigned);
+    check("Optimized rooms are valid", 0, invalidRooms(first));
+    check("Optimizer is deterministic", assignment(first), assignment(second));
+}
+
+static std::string schedule(const LessonList& term, int personId) {
+    std::string entries;
+    for (const TimetableEntry& entry: term.getTimetable(personId).getEntries())
+        entries += std::to_string(entry.slot.lessonId) + "@" + std::to_string(entry.slot.begin) + "-" +
+                   std::to_string(entry.slot.last) + "/" + std::to_string(entry.classroom) + " ";
+    return entries;
+}
+
+// A move that conflicts leaves the lesson, the classroom and every timetable as they were and
+// is not journaled; a move that fits, and a removal, update them all.
+static void testMoveSession() {
+    remove("test.journal");
+    std::string expected;
+    {
+        Journal journal("test.journal");
+        LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+        term.attachJournal(&journal);
+        PersonList people;
+        people.addPerson(Person("T", 1, true));
+        for (int i = 2; i <= 3; i++)
+            people.addPerson(Person("S", i));
+        term.pushPersonList(people);
+        Lesson a(10, "X", 20);
+        a.addSession(WeekTime(Day::tue, Time(13, 0)), 60);
+        term.pushLesson(a);
+        term.setClassroom(10, 1);
+        Lesson b(11, "Y", 20);
+        b.addSession(WeekTime(Day::wed, Time(13, 0)), 60);
+        term.pushLesson(b);
+        term.setClassroom(11, 3);
+        term.setTeacher(1, 10);
+        term.setTeacher(1, 11);
+        term.addStudent(2, 10);
+        term.addStudent(3, 10);
+        term.addStudent(3, 11);
+        term.addSession(10, WeekTime(Day::thu, Time(9, 0)), 90);
+
+        const std::string specsBefore = specs(term), teacherBefore = schedule(term, 1), studentBefore = schedule(term, 3);
+        const auto roomsBefore = term.findFreeClassrooms({{WeekTime(Day::thu, Time(9, 0)), 90}}).size();
+        bool blocked = false;
+        try {
+            // the teacher and student 3 are in lesson 11 on wednesday at 13:00
+            term.moveSession(10, WeekTime(Day::thu, Time(9, 0)), WeekTime(Day::wed, Time(12, 0)), 90);
+        }
+        catch (conflict_error&) {
+            blocked = true;
+        }
+        check("Conflicting move throws", 1, blocked);
+        check("Blocked move keeps the lesson", specsBefore, specs(term));
+        check("Blocked move keeps the teacher's timetable", teacherBefore, schedule(term, 1));
+        check("Blocked move keeps the student's timetable", studentBefore, schedule(term, 3));
+        check("Blocked move keeps the room booked", roomsBefore, term.findFreeClassrooms({{WeekTime(Day::thu, Time(9, 0)), 90}}).size());
+
+        term.moveSession(10, WeekTime(Day::thu, Time(9, 0)), WeekTime(Day::fri, Time(9, 0)), 90);
+        term.removeSession(10, WeekTime(Day::tue, Time(13, 0)));
+        check("Moved session leaves its room", 1, hasRoom(term.findFreeClassrooms({{WeekTime(Day::thu, Time(9, 0)), 90}}), 1));
+        check("Removed session leaves its room", 1, hasRoom(term.findFreeClassrooms({{WeekTime(Day::tue, Time(13, 0)), 60}}), 1));
+        check("Moved session books its room", 0, hasRoom(term.findFreeClassrooms({{WeekTime(Day::fri, Time(9, 0)), 90}}), 1));
+        check("Timetable after move and removal", 1, term.getTimetable(2).getEntries().size());
+        expected = specs(term) + schedule(term, 1) + schedule(term, 3);
+    }
+    LessonList replayed(Date(1, 1, 2024), Date(1, 6, 2024));
+    replayed.replayJournal("test.journal");
+    check("Replayed moves", expected, specs(replayed) + schedule(replayed, 1) + schedule(replayed, 3));
+    remove("test.journal");
+}
+
+// Unassigning a teacher or a classroom frees that slot while the students keep the lesson without
+// a room; removing a lesson frees its room and every timetable, so the slot and the id can be reused.
+static void testUnassign() {
+    remove("test.journal");
+    std::string expected;
+    {
+        Journal journal("test.journal");
+        LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+        term.attachJournal(&journal);
+        PersonList people;
+        people.addPerson(Person("T", 1, true));
+        for (int i = 2; i <= 3; i++)
+            people.addPerson(Person("S", i));
+        term.pushPersonList(people);
+        Lesson a(10, "X", 20);
+        a.addSession(WeekTime(Day::tue, Time(13, 0)), 60);
+        term.pushLesson(a);
+        term.setClassroom(10, 1);
+        Lesson b(11, "Y", 20);
+        b.addSession(WeekTime(Day::wed, Time(13, 0)), 60);
+        term.pushLesson(b);
+        term.setClassroom(11, 3);
+        term.setTeacher(1, 10);
+        term.setTeacher(1, 11);
+        term.addStudent(2, 10);
+        term.addStudent(3, 10);
+        term.addStudent(3, 11);
+        const std::string teacherBefore = schedule(term, 1), studentBefore = schedule(term, 3);
+
+        term.unassignTeacher(11);
+        check("Unassigned teacher keeps other lessons", "10 ", lessonsOf(term, 1));
+        check("Unassigned teacher's timetable", teacherBefore.substr(0, teacherBefore.find("11@")), schedule(term, 1));
+        check("Students keep a lesson without teacher", studentBefore, schedule(term, 3));
+
+        term.unassignClassroom(11);
+        check("Unassigned room is free", 1, hasRoom(term.findFreeClassrooms({{WeekTime(Day::wed, Time(13, 0)), 60}}), 3));
+        std::string roomless = studentBefore;
+        roomless.replace(roomless.rfind("/3 "), 3, "/-1 ");
+        check("Students keep a lesson without room", roomless, schedule(term, 3));
+
+        term.removeLesson(10);
+        check("Removed lesson frees its room", 1, hasRoom(term.findFreeClassrooms({{WeekTime(Day::tue, Time(13, 0)), 60}}), 1));
+        check("Removed lesson leaves the teacher", "", schedule(term, 1));
+        check("Removed lesson leaves the students", "", schedule(term, 2));
+        check("Other lessons stay in the timetable", roomless.substr(roomless.find("11@")), schedule(term, 3));
+        check("Removed lesson is gone", "11 ", lessonsOf(term, 3));
+
+        // the same id, room, teacher and students again; any leftover booking would conflict
+        term.pushLesson(a);
+        term.setClassroom(10, 1);
+        term.setTeacher(1, 10);
+        term.addStudent(2, 10);
+        term.addStudent(3, 10);
+        check("Freed slots and id reused", teacherBefore.substr(0, teacherBefore.find("11@")), schedule(term, 1));
+        check("Reused lesson in the timetable", roomless, schedule(term, 3));
+        expected = schedule(term, 1) + schedule(term, 2) + schedule(term, 3) + lessonsOf(term, 3);
+    }
+    LessonList replayed(Date(1, 1, 2024), Date(1, 6, 2024));
+    replayed.replayJournal("test.journal");
+    check("Replayed unassignments", expected, schedule(replayed, 1) + schedule(replayed, 2) + schedule(replayed, 3) + lessonsOf(replayed, 3));
+    remove("test.journal");
+}
+
+static const ClassroomStats& roomStats(const TermStats& stats, int number) {
+    for (const ClassroomStats& room: stats.classrooms)
+        if (room.number == number)
+            return room;
+    throw "Couldn't Find Such a Classroom!";
+}
+
+// Ratios are checked scaled by 10000 and rounded. Rooms 1 and 4 have a projector, room 2 does not;
+// lesson 11 does not need the projector of room 4.
+static void testStats() {
+    LessonList term(Date(1, 1, 2024), Date(1, 6, 2024));
+    PersonList people;
+    people.addPerson(Person("T", 1, true));
+    for (int i = 2; i <= 4; i++)
+        people.addPerson(Person("S", i));
+    term.pushPersonList(people);
+    Lesson a(10, "X", 20, true);
+    a.addSession(WeekTime(Day::tue, Time(13, 0)), 60);
+    a.addSession(WeekTime(Day::thu, Time(9, 0)), 90);
+    term.pushLesson(a);
+    term.setClassroom(10, 1);
+    Lesson b(11, "Y", 10);
+    b.addSession(WeekTime(Day::wed, Time(10, 0)), 120);
+    term.pushLesson(b);
+    term.setClassroom(11, 4);
+    Lesson c(12, "Z", 15);
+    c.addSession(WeekTime(Day::sun, Time(9, 0)), 30);
+    term.pushLesson(c);
+    term.setClassroom(12, 2);
+    term.setTeacher(1, 10);
+    term.setTeacher(1, 11);
+    term.addStudent(2, 10);
+    term.addStudent(3, 10);
+    term.addStudent(4, 11);
+
+    const TermStats stats = term.computeStats();
+    const int window = 7 * (MAX_START_HOUR - MIN_START_HOUR) * 60;
+    check("Stats cover every room", term.getClassroomList().getList().size(), stats.classrooms.size());
+    check("Booked minutes", 300, stats.bookedMinutes);
+    check("Available minutes", window * static_cast<long long>(stats.classrooms.size()), stats.availableMinutes);
+    check("Projector minutes without need", 120, stats.projectorMinutesWithoutNeed);
+
+    const ClassroomStats& one = roomStats(stats, 1);
+    check("Room booked minutes", 150, one.bookedMinutes);
+    check("Room window", window, one.availableMinutes);
+    check("Room utilization", std::llround(150 * 10000.0 / window), std::llround(one.utilization * 10000));
+    // 2 of 25 seats taken
+    check("Room seat efficiency", 800, std::llround(one.seatEfficiency * 10000));
+    check("Needed projector is not waste", 0, one.projectorMinutesWithoutNeed);
+
+    const ClassroomStats& four = roomStats(stats, 4);
+    // 1 of 12 seats taken
+    check("Small room seat efficiency", 833, std::llround(four.seatEfficiency * 10000));
+    check("Unneeded projector is waste", 120, four.projectorMinutesWithoutNeed);
+    const ClassroomStats& two = roomStats(stats, 2);
+    check("Empty lesson seat efficiency", 0, std::llround(two.seatEfficiency * 10000));
+    check("Room without projector wastes none", 0, two.projectorMinutesWithoutNeed);
+    const ClassroomStats& three = roomStats(stats, 3);
+    check("Unused room", 0, three.bookedMinutes + std::llround(three.utilization * 10000));
+
+    check("Teachers counted", 1, stats.teacherWeeklyHours.size());
+    check("Teacher weekly hours", 45000, std::llround(stats.teacherWeeklyHours.at(1) * 10000));
+}
+
+int main() {
+    try {
+        testJournal();
+#ifndef _WIN32
+        testJournalFailure();
+#endif
+        testSnapshot();
+        testXml();
+        testFeatures();
+        testFreeClassrooms();
+        testWaitlist();
+        testOptimizer();
+        testMoveSession();
+        testUnassign();
+        testStats();
+    }
+    catch (char const* s) {
+        ++failed;
+        std::cout << "[fail] unexpected exception: " << s << std::endl;
+    }
+    std::cout << "Pass " << passed << ", Fail " << failed << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,708 @@
+// Tests for the changes made to tinyxml2 in this tree. Each one compares what a
+// feature produces with what the plain DOM parse of the same input gives.
+
+#include "../tinyxml2.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tinyxml2;
+
+static int gPass = 0;
+static int gFail = 0;
+
+static bool XMLTest( const char* testString, const std::string& expected, const std::string& found )
+{
+    const bool pass = expected == found;
+    if ( pass ) {
+        ++gPass;
+    }
+    else {
+        ++gFail;
+        printf( "[fail] %s\n  expected: %.200s\n  found:    %.200s\n", testString, expected.c_str(), found.c_str() );
+    }
+    return pass;
+}
+
+static bool XMLTest( const char* testString, long long expected, long long found )
+{
+    return XMLTest( testString, std::to_string( expected ), std::to_string( found ) );
+}
+
+static std::string Print( const XMLDocument& doc )
+{
+    XMLPrinter printer;
+    doc.Print( &printer );
+    return printer.CStr();
+}
+
+// The line of every node and attribute, and whether it belongs to the document and parent
+// it is linked under.
+static std::string Lines( const XMLNode* node )
+{
+    std::string lines;
+    for ( const XMLNode* child = node->FirstChild(); child; child = child->NextSibling() ) {
+        lines += std::to_string( child->GetLineNum() );
+        if ( child->GetDocument() != node->GetDocument() || child->Parent() != node ) {
+            lines += "!";
+        }
+        if ( const XMLElement* element = child->ToElement() ) {
+            for ( const XMLAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() ) {
+                lines += "," + std::to_string( attribute->GetLineNum() );
+            }
+        }
+        lines += "(" + Lines( child ) + ")";
+    }
+    return lines;
+}
+
+// ScanText and SkipWhiteSpaceRun scan in SIMD blocks: they must stop where the byte loops
+// stop and count the same newlines, from any alignment and across block ends.
+static void TestScanText()
+{
+    std::mt19937 rng( 42 );
+    static const char text[] = "ab \n<>&-]?x\xc3\xa9\t";
+    static const char space[] = " \t\n\r\v\f";
+    static const char ends[] = "<&]\n";
+    char buffer[192];
+    int textMismatches = 0;
+    int spaceMismatches = 0;
+    for ( int i = 0; i < 50000; ++i ) {
+        char* const p = buffer + rng() % 64;
+        const int length = static_cast<int>( rng() % 100 );
+        const bool spaces = i % 2 != 0;
+        for ( int j = 0; j < length; ++j ) {
+            p[j] = spaces && rng() % 16 ? space[rng() % 6] : text[rng() % ( sizeof( text ) - 1 )];
+        }
+        p[length] = 0;
+
+        if ( !spaces ) {
+            const char endChar = ends[rng() % ( sizeof( ends ) - 1 )];
+            const char* q = p;
+            int lines = 0;
+            while ( *q && *q != endChar ) {
+                lines += *q == '\n';
+                ++q;
+            }
+            int scanned = 0;
+            if ( XMLUtil::ScanText( p, endChar, &scanned ) != q || scanned != lines ) {
+                ++textMismatches;
+            }
+        }
+        else {
+            const char* q = p;
+            int lines = 0;
+            while ( XMLUtil::IsWhiteSpace( *q ) ) {
+                lines += *q == '\n';
+                ++q;
+            }
+            int skipped = 0;
+            if ( XMLUtil::SkipWhiteSpaceRun( p, &skipped ) != q || skipped != lines ) {
+                ++spaceMismatches;
+            }
+        }
+    }
+    XMLTest( "ScanText matches the byte loop", 0, textMismatches );
+    XMLTest( "SkipWhiteSpaceRun matches the byte loop", 0, spaceMismatches );
+}
+
+// The sscanf conversions the XMLUtil number parsers replaced.
+static bool ScanfInt( const char* str, int* value )
+{
+    if ( XMLUtil::IsPrefixHex( str ) ) {
+        unsigned v;
+        if ( sscanf( str, "%x", &v ) == 1 ) {
+            *value = static_cast<int>( v );
+            return true;
+        }
+        return false;
+    }
+    return sscanf( str, "%d", value ) == 1;
+}
+
+static bool ScanfUnsigned( const char* str, unsigned* value )
+{
+    return sscanf( str, XMLUtil::IsPrefixHex( str ) ? "%x" : "%u", value ) == 1;
+}
+
+static bool ScanfInt64( const char* str, int64_t* value )
+{
+    if ( XMLUtil::IsPrefixHex( str ) ) {
+        unsigned long long v = 0;
+        if ( sscanf( str, "%llx", &v ) == 1 ) {
+            *value = static_cast<int64_t>( v );
+            return true;
+        }
+        return false;
+    }
+    long long v = 0;
+    if ( sscanf( str, "%lld", &v ) == 1 ) {
+        *value = static_cast<int64_t>( v );
+        return true;
+    }
+    return false;
+}
+
+static bool ScanfUnsigned64( const char* str, uint64_t* value )
+{
+    unsigned long long v = 0;
+    if ( sscanf( str, XMLUtil::IsPrefixHex( str ) ? "%llx" : "%llu", &v ) == 1 ) {
+        *value = static_cast<uint64_t>( v );
+        return true;
+    }
+    return false;
+}
+
+static bool ScanfBool( const char* str, bool* value )
+{
+    int i = 0;
+    if ( ScanfInt( str, &i ) ) {
+        *value = i != 0;
+        return true;
+    }
+    for ( const char* t : { "true", "True", "TRUE" } ) {
+        if ( strcmp( str, t ) == 0 ) {
+            *value = true;
+            return true;
+        }
+    }
+    for ( const char* f : { "false", "False", "FALSE" } ) {
+        if ( strcmp( str, f ) == 0 ) {
+            *value = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Same result and, when read, the same bits; any two NaNs are the same.
+template< class T >
+static bool SameNumber( bool read, T value, bool expectedRead, T expected )
+{
+    if ( read != expectedRead ) {
+        return false;
+    }
+    return !read || memcmp( &value, &expected, sizeof( T ) ) == 0 || ( value != value && expected != expected );
+}
+
+static int NumberMismatches( const char* str )
+{
+    int mismatches = 0;
+    {
+        int a = 7, b = 7;
+        const bool x = XMLUtil::ToInt( str, &a );
+        const bool y = ScanfInt( str, &b );
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    {
+        unsigned a = 7, b = 7;
+        const bool x = XMLUtil::ToUnsigned( str, &a );
+        const bool y = ScanfUnsigned( str, &b );
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    {
+        int64_t a = 7, b = 7;
+        const bool x = XMLUtil::ToInt64( str, &a );
+        const bool y = ScanfInt64( str, &b );
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    {
+        uint64_t a = 7, b = 7;
+        const bool x = XMLUtil::ToUnsigned64( str, &a );
+        const bool y = ScanfUnsigned64( str, &b );
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    {
+        bool a = false, b = false;
+        const bool x = XMLUtil::ToBool( str, &a );
+        const bool y = ScanfBool( str, &b );
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    {
+        float a = 7, b = 7;
+        const bool x = XMLUtil::ToFloat( str, &a );
+        const bool y = sscanf( str, "%f", &b ) == 1;
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    {
+        double a = 7, b = 7;
+        const bool x = XMLUtil::ToDouble( str, &a );
+        const bool y = sscanf( str, "%lf", &b ) == 1;
+        mismatches += !SameNumber( x, a, y, b );
+    }
+    if ( mismatches ) {
+        printf( "  number mismatch: [%s]\n", str );
+    }
+    return mismatches;
+}
+
+static void TestNumbers()
+{
+    static const char* const edges[] = {
+        "0x", "0xg", "-0x10", "+0x10", " 0x10", "0X1F", "5", "+5", "-5", " \v\t5", "- 5", "+-5", "", "  ",
+        "4294967296", "4294967295", "-1", "99999999999", "-99999999999", "9223372036854775807",
+        "9223372036854775808", "18446744073709551615", "18446744073709551616", "-9223372036854775809",
+        "12abc", "0x1p3", "1e400", "-1e400", "1e-400", ".5", "5.", "1e", "1e+", "infinity", "-inf",
+        "nan(abc)", "NaN", "0x.8", "0x1.8p1", ".", "+.5e1", "x5", "0xffffffffff", "-0x1",
+        "0x8000000000000000", "0xfffffffffffffffff", "08", "0b1", "1,5", "0x1p", "0xp1", "1.5e+3xyz",
+        "00012", "-0", "3.4028235e38", "3.5e38", "1e-50", "2.4703282292062328e-324",
+        "0x1.fffffffffffff8p1023", "1.7976931348623158e308", "1.7976931348623159e308", "infinit", "nanx",
+        "nan(", "nan()", "inFINity", "true", "True", "TRUE", "false", "tRue", "yes", "t", "f", " true"
+    };
+    int mismatches = 0;
+    for ( const char* edge : edges ) {
+        mismatches += NumberMismatches( edge );
+    }
+
+    std::mt19937 rng( 1 );
+    static const char alphabet[] = "0123456789abcdefxXpPeE+-. \tinfty";
+    for ( int i = 0; i < 200000; ++i ) {
+        std::string str;
+        for ( int length = static_cast<int>( rng() % 12 ); length > 0; --length ) {
+            str += alphabet[rng() % ( sizeof( alphabet ) - 1 )];
+        }
+        mismatches += NumberMismatches( str.c_str() );
+    }
+    for ( int i = 0; i < 20000; ++i ) {
+        const uint64_t bits = ( static_cast<uint64_t>( rng() ) << 32 ) | rng();
+        double d;
+        memcpy( &d, &bits, sizeof( d ) );
+        char str[64];
+        snprintf( str, sizeof( str ), i % 3 == 0 ? "%.17g" : ( i % 3 == 1 ? "%.9g" : "%g" ), d );
+        mismatches += NumberMismatches( str );
+        snprintf( str, sizeof( str ), "%lld", static_cast<long long>( bits ) );
+        mismatches += NumberMismatches( str );
+        snprintf( str, sizeof( str ), "0x%llx", static_cast<unsigned long long>( bits >> ( rng() % 64 ) ) );
+        mismatches += NumberMismatches( str );
+    }
+    XMLTest( "Number parsing matches sscanf", 0, mismatches );
+}
+
+static std::string RandomElement( std::mt19937& rng, int depth )
+{
+    static const char* const names[] = { "a", "b", "cc", "classroom", "x:y", "_z" };
+    const std::string name = names[rng() % 6];
+    std::string xml = "<" + name;
+    for ( int i = static_cast<int>( rng() % 4 ); i > 0; --i ) {
+        xml += " " + std::string( names[rng() % 6] ) + std::to_string( i ) + "=\"v" + std::to_string( rng() % 9 ) + "\"";
+    }
+    if ( rng() % 3 == 0 ) {
+        return xml + "/>";
+    }
+    xml += ">";
+    for ( int i = depth < 4 ? static_cast<int>( rng() % 5 ) : 0; i > 0; --i ) {
+        xml += rng() % 4 ? RandomElement( rng, depth + 1 ) : "text";
+    }
+    return xml + "</" + name + ">";
+}
+
+// What the lookups by name find under node, checked against the lookups by handle.
+static std::string Lookups( XMLNode* node, XMLDocument& doc )
+{
+    static const char* const names[] = { "a", "b", "cc", "classroom", "x:y", "_z", "none" };
+    std::string found;
+    for ( const char* name : names ) {
+        const XMLName handle = doc.Intern( name );
+        XMLElement* const first = node->FirstChildElement( name );
+        XMLElement* const last = node->LastChildElement( name );
+        found += first ? first->Name() : "-";
+        found += last ? "L" : "-";
+        if ( node->FirstChildElement( handle ) != first || node->LastChildElement( handle ) != last ) {
+            found += "!";
+        }
+        if ( first && ( first->NextSiblingElement( handle ) != first->NextSiblingElement( name )
+                        || last->PreviousSiblingElement( handle ) != last->PreviousSiblingElement( name ) ) ) {
+            found += "!";
+        }
+        for ( int i = 1; first && i < 4; ++i ) {
+            const std::string attributeName = name + std::to_string( i );
+            const XMLAttribute* const attribute = first->FindAttribute( attributeName.c_str() );
+            found += attribute ? attribute->Value() : ".";
+            if ( first->FindAttribute( doc.Intern( attributeName.c_str() ) ) != attribute ) {
+                found += "!";
+            }
+        }
+    }
+    for ( XMLNode* child = node->FirstChild(); child; child = child->NextSibling() ) {
+        found += "(" + Lookups( child, doc ) + ")";
+    }
+    return found;
+}
+
+// A document that interns names parses, prints and finds the same as one that does not.
+static void TestInternedNames()
+{
+    std::mt19937 rng( 42 );
+    int mismatches = 0;
+    for ( int i = 0; i < 1000; ++i ) {
+        const std::string xml = RandomElement( rng, 0 );
+        XMLDocument plain;
+        XMLDocument interned( true, PRESERVE_WHITESPACE, true );
+        plain.Parse( xml.c_str() );
+        interned.Parse( xml.c_str() );
+        if ( plain.Error() || interned.Error() ) {
+            ++mismatches;
+            continue;
+        }
+        if ( Print( plain ) != Print( interned ) || Lookups( &plain, plain ) != Lookups( &interned, interned ) ) {
+            ++mismatches;
+            continue;
+        }
+
+        // Names set after the parse are interned too.
+        XMLElement* const root = interned.RootElement();
+        root->SetName( "renamed" );
+        root->SetAttribute( "added", 5 );
+        XMLElement* const added = root->InsertNewChildElement( "classroom" );
+        if ( interned.FirstChildElement( interned.Intern( "renamed" ) ) != root
+             || !root->FindAttribute( interned.Intern( "added" ) )
+             || root->LastChildElement( interned.Intern( "classroom" ) ) != added ) {
+            ++mismatches;
+        }
+    }
+    XMLTest( "Interned names find what plain names find", 0, mismatches );
+
+    // Handles stay valid across reloads.
+    XMLDocument doc( true, PRESERVE_WHITESPACE, true );
+    const XMLName classroom = doc.Intern( "classroom" );
+    doc.Parse( "<rooms><lab/><classroom number='1'/></rooms>" );
+    doc.Parse( "<rooms><classroom number='2'/></rooms>" );
+    const XMLElement* const room = doc.RootElement()->FirstChildElement( classroom );
+    XMLTest( "Interned handle after a reload", "2", room ? room->Attribute( "number" ) : "" );
+}
+
+// The name and line of each element, text and comment, in document order.
+class LineVisitor : public XMLVisitor
+{
+public:
+    virtual bool VisitEnter( const XMLElement& element, const XMLAttribute* ) {
+        lines += std::string( element.Name() ) + ":" + std::to_string( element.GetLineNum() ) + " ";
+        return true;
+    }
+    virtual bool Visit( const XMLText& text ) {
+        lines += "T:" + std::to_string( text.GetLineNum() ) + " ";
+        return true;
+    }
+    virtual bool Visit( const XMLComment& comment ) {
+        lines += "C:" + std::to_string( comment.GetLineNum() ) + " ";
+        return true;
+    }
+
+    std::string lines;
+};
+
+// Fed in chunks of any size, the push parser reports what a parse of the whole document
+// holds, and fails where it fails.
+static void TestPushParser()
+{
+    static const char* const documents[] = {
+        "<?xml version=\"1.0\"?>\n<!-- top -->\n<root a=\"x>y\" b='1'>\n  <c d=\"1\"/>\n  text &amp; more\n"
+        "  <![CDATA[ <not/> ]]>\n  <e>\n<f/>\n</e><!--c-->\n<?pi x?>\n</root>\n<!-- after -->\n",
+        "<a/>", " <a><b><c><d/></c></b></a> ", "<a>\n<b\nx='1'\n>\n<c/></b>\n<b/></a>",
+        "<!DOCTYPE a><a>&lt;</a>", "<a><b a=\"'\">'</b></a>",
+        "<a><b></c></a>", "<a><b>", "", "<a><!-- x -- y --></a>", "<a x='1' x='2'/>"
+    };
+    static const size_t chunks[] = { 1, 3, 64, 1 << 20 };
+    int mismatches = 0;
+    for ( const char* xml : documents ) {
+        const size_t size = strlen( xml );
+        XMLDocument doc;
+        doc.Parse( xml, size );
+        XMLPrinter printed;
+        LineVisitor lines;
+        if ( !doc.Error() ) {
+            doc.Print( &printed );
+            doc.Accept( &lines );
+        }
+        for ( int depth = 0; depth < 3; ++depth ) {
+            for ( size_t chunk : chunks ) {
+                XMLPrinter pushedPrinted;
+                LineVisitor pushedLines;
+                XMLPushParser printer( &pushedPrinted, depth );
+                XMLPushParser liner( &pushedLines, depth );
+                for ( size_t i = 0; i < size; i += chunk ) {
+                    const size_t n = size - i < chunk ? size - i : chunk;
+                    printer.Feed( xml + i, n );
+                    liner.Feed( xml + i, n );
+                }
+                printer.Finish();
+                liner.Finish();
+                const bool same = doc.Error() ? printer.Error()
+                                  : !printer.Error() && std::string( printed.CStr() ) == pushedPrinted.CStr() && lines.lines == pushedLines.lines;
+                if ( !same ) {
+                    ++mismatches;
+                    printf( "  push mismatch: depth %d chunk %d [%s]\n", depth, static_cast<int>( chunk ), xml );
+                }
+            }
+        }
+    }
+    XMLTest( "Push parser matches the document parse", 0, mismatches );
+
+    // Reset() starts another document.
+    XMLPrinter printer;
+    XMLPushParser parser( &printer );
+    parser.Feed( "<a><b>", 6 );
+    parser.Reset();
+    parser.Feed( "<c/>", 4 );
+    XMLTest( "Push parser after Reset", XML_SUCCESS, parser.Finish() );
+}
+
+// Records SAX events in the form ElementWalker records a DOM.
+class EventRecorder : public XMLSaxHandler
+{
+public:
+    EventRecorder() : stopAt( -1 ), elements( 0 ) {}
+
+    virtual bool StartElement( const char* name, const XMLSaxAttributes& attributes ) {
+        events += std::string( "<" ) + name;
+        for ( int i = 0; i < attributes.Count(); ++i ) {
+            events += std::string( " " ) + attributes.Name( i ) + "=" + attributes.Value( i );
+        }
+        events += ">";
+        return ++elements != stopAt;
+    }
+    virtual bool EndElement( const char* name ) {
+        events += std::string( "</" ) + name + ">";
+        return true;
+    }
+    virtual bool Text( const char* text, bool cdata ) {
+        events += std::string( cdata ? "C[" : "T[" ) + text + "]";
+        return true;
+    }
+
+    std::string events;
+    int stopAt;
+    int elements;
+};
+
+class ElementWalker : public XMLVisitor
+{
+public:
+    virtual bool VisitEnter( const XMLElement& element, const XMLAttribute* attribute ) {
+        events += std::string( "<" ) + element.Name();
+        for ( ; attribute; attribute = attribute->Next() ) {
+            events += std::string( " " ) + attribute->Name() + "=" + attribute->Value();
+        }
+        events += ">";
+        return true;
+    }
+    virtual bool VisitExit( const XMLElement& element ) {
+        events += std::string( "</" ) + element.Name() + ">";
+        return true;
+    }
+    virtual bool Visit( const XMLText& text ) {
+        events += std::string( text.CData() ? "C[" : "T[" ) + text.Value() + "]";
+        return true;
+    }
+
+    std::string events;
+};
+
+// A SAX parse reports the elements and text a DOM parse builds, in every whitespace mode,
+// and builds no nodes.
+static void TestSax()
+{
+    std::vector<std::string> documents = {
+        "<?xml version=\"1.0\"?>\n<root k=\"v\">\n  t &amp;  &#65;x\n y <!--c--><![CDATA[<x> &amp;]]>"
+        "<!X y>\n  <c:d q=\"a&lt;b\"\n r = '\"'/>\n  <e-f>  </e-f><a> <!--c--> </a></root>\n",
+        "\xEF\xBB\xBF<a/>", "<a b='&#x41;&unknown;'/>", "<a>  </a>",
+        "<a>", "<a></b>", "<a x='1' x='2'/>", "<a x=1/>", "<!-- x", "<a><![CDATA[x</a>", "text<a/>"
+    };
+    std::mt19937 rng( 7 );
+    for ( int i = 0; i < 300; ++i ) {
+        documents.push_back( RandomElement( rng, 0 ) );
+    }
+    int mismatches = 0;
+    for ( const std::string& xml : documents ) {
+        for ( Whitespace whitespace : { PRESERVE_WHITESPACE, COLLAPSE_WHITESPACE, PEDANTIC_WHITESPACE } ) {
+            for ( bool entities : { true, false } ) {
+                XMLDocument dom( entities, whitespace );
+                dom.Parse( xml.c_str(), xml.size() );
+                ElementWalker walker;
+                dom.Accept( &walker );
+
+                EventRecorder recorder;
+                XMLDocument sax( entities, whitespace );
+                sax.SetSaxHandler( &recorder );
+                sax.Parse( xml.c_str(), xml.size() );
+                const bool same = dom.Error() ? sax.Error() : !sax.Error() && recorder.events == walker.events && !sax.FirstChild();
+                if ( !same ) {
+                    ++mismatches;
+                    printf( "  SAX mismatch: [%s]\n", xml.c_str() );
+                }
+            }
+        }
+    }
+    XMLTest( "SAX events match the DOM", 0, mismatches );
+
+    // Returning false stops the parse.
+    EventRecorder stopper;
+    stopper.stopAt = 2;
+    XMLDocument doc;
+    doc.SetSaxHandler( &stopper );
+    doc.Parse( "<a><b/><c/></a>" );
+    XMLTest( "SAX parse stopped by the handler", "<a><b>", stopper.events );
+}
+
+class StringSink : public XMLSink
+{
+public:
+    virtual void Write( const char* data, size_t size ) {
+        out.append( data, size );
+    }
+    std::string out;
+};
+
+class FailingSink : public XMLSink
+{
+public:
+    virtual void Write( const char*, size_t ) {
+        throw "write failed";
+    }
+};
+
+template< class Printer >
+static void PrintElements( Printer& printer, int count, int textSize )
+{
+    const std::string text( textSize, 'x' );
+    printer.PushHeader( true, true );
+    printer.OpenElement( "root" );
+    for ( int i = 0; i < count; ++i ) {
+        printer.OpenElement( "e" );
+        printer.PushAttribute( "i", i );
+        printer.PushAttribute( "d", i * 0.5 );
+        printer.PushAttribute( "s", "a<b&c\"" );
+        if ( i % 7 == 0 ) {
+            printer.PushText( text.c_str() );
+        }
+        if ( i % 5 == 0 ) {
+            printer.PushComment( "c" );
+        }
+        printer.PushText( i );
+        printer.CloseElement();
+    }
+    printer.PushUnknown( "DOCTYPE x" );
+    printer.CloseElement();
+}
+
+// A printer writing to a sink writes what a printer to memory holds, with text larger than
+// its buffer; a sink that throws can be flushed and the printer destroyed afterwards.
+static void TestSink()
+{
+    int mismatches = 0;
+    for ( int count : { 0, 1, 10, 5000 } ) {
+        for ( int textSize : { 0, 100, 70000 } ) {
+            for ( bool compact : { false, true } ) {
+                XMLPrinter memory( 0, compact );
+                PrintElements( memory, count, textSize );
+                StringSink sink;
+                {
+                    XMLPrinter printer( sink, compact );
+                    PrintElements( printer, count, textSize );
+                }
+                if ( sink.out != memory.CStr() ) {
+                    ++mismatches;
+                    printf( "  sink mismatch: count=%d textSize=%d compact=%d\n", count, textSize, compact );
+                }
+            }
+        }
+    }
+    XMLTest( "Sink output matches the memory printer", 0, mismatches );
+
+    XMLDocument doc;
+    doc.Parse( "<a x='1'><b>t</b><!--c--><![CDATA[z]]></a>" );
+    XMLPrinter memory;
+    doc.Print( &memory );
+    StringSink sink;
+    XMLPrinter printer( sink );
+    doc.Print( &printer );
+    printer.Flush();
+    XMLTest( "Document printed to a sink", memory.CStr(), sink.out );
+
+    FailingSink failing;
+    bool thrown = false;
+    {
+        XMLPrinter failingPrinter( failing );
+        failingPrinter.OpenElement( "a" );
+        failingPrinter.CloseElement();
+        try {
+            failingPrinter.Flush();
+        }
+        catch ( const char* ) {
+            thrown = true;
+        }
+    }
+    XMLTest( "Failing sink throws from Flush", 1, thrown );
+}
+
+// Parses xml serially and on threads and checks the results are the same.
+static void ParallelTest( const char* testString, const std::string& xml, XMLError expected )
+{
+    XMLDocument serial;
+    XMLDocument parallel;
+    parallel.SetParseThreads( 4 );
+    serial.Parse( xml.c_str(), xml.size() );
+    parallel.Parse( xml.c_str(), xml.size() );
+    XMLTest( testString, expected, serial.ErrorID() );
+    XMLTest( testString, serial.ErrorID(), parallel.ErrorID() );
+    XMLTest( testString, serial.ErrorLineNum(), parallel.ErrorLineNum() );
+    if ( !serial.Error() ) {
+        XMLTest( testString, Print( serial ), Print( parallel ) );
+        XMLTest( testString, Lines( &serial ), Lines( &parallel ) );
+    }
+}
+
+static void TestParallelParse()
+{
+    // Enough children for four parts of at least MIN_PARTITION_BYTES.
+    const int children = 40000;
+
+    std::string flat = "<?xml version=\"1.0\"?>\n<!-- head -->\n<classrooms>\n";
+    for ( int i = 0; i < children; ++i ) {
+        flat += "  <classroom number=\"" + std::to_string( i ) + "\"\n      capacity=\"30\">text &amp; more</classroom>\n";
+    }
+    flat += "</classrooms>\n";
+    ParallelTest( "Parallel parse", flat, XML_SUCCESS );
+
+    // An end tag without a start tag ends a part early, where the serial parse reports it.
+    std::string stray = flat;
+    stray.insert( stray.find( "  <classroom", stray.size() / 8 * 7 ), "</bogus>" );
+    ParallelTest( "Parallel parse with a stray end tag", stray, XML_ERROR_MISMATCHED_ELEMENT );
+
+    // Children named like the first one nested deeper: splits land inside a child.
+    std::string nested = "<a>\n";
+    for ( int i = 0; i < children / 2; ++i ) {
+        nested += "<a x='" + std::to_string( i ) + "'>\n";
+        for ( int j = 0; j < 8; ++j ) {
+            nested += "  <a>t</a>\n";
+        }
+        nested += "</a>\n";
+    }
+    nested += "</a>\n";
+    ParallelTest( "Parallel parse of nested children", nested, XML_SUCCESS );
+
+    // Splits that land in comments.
+    std::string comments = "<rooms>\n";
+    for ( int i = 0; i < children / 4; ++i ) {
+        comments += "<room n='" + std::to_string( i ) + "'/><!-- " + std::string( 40, '.' ) + "> <room n='0'/> -->\n";
+    }
+    comments += "</rooms>\n";
+    ParallelTest( "Parallel parse with splits in comments", comments, XML_SUCCESS );
+}
+
+int main()
+{
+    TestScanText();
+    TestNumbers();
+    TestInternedNames();
+    TestPushParser();
+    TestSax();
+    TestSink();
+    TestParallelParse();
+
+    printf( "Pass %d, Fail %d\n", gPass, gFail );
+    return gFail ? 1 : 0;
+}
@@ -119,6 +119,48 @@ distribution.
 	#define TIXML_FTELL ftell
 #endif
 
+// Numbers are read with std::from_chars where the standard library has it for floating point.
+#if defined(__has_include)
+	#if __has_include(<charconv>) && ( __cplusplus >= 201703L || ( defined(_MSVC_LANG) && _MSVC_LANG >= 201703L ) )
+		#include <charconv>
+		#include <cstring>
+		#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+			#define TIXML_FROM_CHARS
+		#endif
+	#endif
+#endif
+
+// Text and whitespace scanning works on 16 (SSE2) or 32 (AVX2) byte blocks, picked at runtime.
+// Blocks are aligned loads, so reading past the null terminator never touches another page.
+// Define TINYXML2_NO_SIMD to always scan byte by byte; address sanitizer builds do so anyway.
+#if !defined(TINYXML2_NO_SIMD) && !defined(__SANITIZE_ADDRESS__) && ( defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+	#define TIXML_SSE2
+	#include <emmintrin.h>
+	#if ( defined(__GNUC__) || defined(__clang__) ) && !defined(__INTEL_COMPILER)
+		#define TIXML_AVX2
+		#include <immintrin.h>
+	#endif
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+// Regular files are parsed straight from a private (copy on write) mapping on POSIX systems.
+// Define TINYXML2_NO_MMAP to always read the file into a heap buffer.
+#if !defined(_WIN32) && !defined(TINYXML2_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+	#define TIXML_USE_MMAP
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+// Documents with more than one parse thread are split between std::threads.
+// Define TINYXML2_NO_THREADS to always parse on the calling thread.
+#if !defined(TINYXML2_NO_THREADS)
+	#define TIXML_USE_THREADS
+	#include <thread>
+#endif
+
 
 static const char LINE_FEED				= static_cast<char>(0x0a);			// all line endings are normalized to LF
 static const char LF = LINE_FEED;
@@ -219,18 +261,21 @@ char* StrPair::ParseText( char* p, const char* endTag, int strFlags, int* curLin
     const char  endChar = *endTag;
     size_t length = strlen( endTag );
 
-    // Inner loop of text parsing.
-    while ( *p ) {
-        if ( *p == endChar && strncmp( p, endTag, length ) == 0 ) {
+    // Inner loop of text parsing: jump from one candidate end character to the next.
+    for( ;; ) {
+        p = const_cast<char*>( XMLUtil::ScanText( p, endChar, curLineNumPtr ) );
+        if ( !*p ) {
+            return 0;
+        }
+        if ( strncmp( p, endTag, length ) == 0 ) {
             Set( start, p, strFlags );
             return p + length;
-        } else if (*p == '\n') {
+        }
+        if ( *p == '\n' ) {
             ++(*curLineNumPtr);
         }
         ++p;
-        TIXMLASSERT( p );
     }
-    return 0;
 }
 
 
@@ -386,8 +431,297 @@ const char* StrPair::GetStr()
 
 
 
+// --------- NameTable ----------- //
+
+NameTable::~NameTable()
+{
+    for( size_t i = 0; i < _capacity; ++i ) {
+        delete [] _slots[i];
+    }
+    delete [] _slots;
+}
+
+
+// Index of the slot holding name, or of the empty slot where it would go.
+size_t NameTable::Slot( const char* name, size_t length ) const
+{
+    TIXMLASSERT( _capacity && ( _capacity & ( _capacity - 1 ) ) == 0 );
+    uint32_t hash = 2166136261u;
+    for( size_t i = 0; i < length; ++i ) {
+        hash = ( hash ^ static_cast<unsigned char>( name[i] ) ) * 16777619u;
+    }
+    size_t slot = hash & ( _capacity - 1 );
+    while ( _slots[slot] && !( strncmp( _slots[slot], name, length ) == 0 && _slots[slot][length] == 0 ) ) {
+        slot = ( slot + 1 ) & ( _capacity - 1 );
+    }
+    return slot;
+}
+
+
+void NameTable::Grow()
+{
+    char** old = _slots;
+    const size_t oldCapacity = _capacity;
+    _capacity = _capacity ? _capacity * 2 : 64;
+    _slots = new char*[_capacity];
+    memset( _slots, 0, _capacity * sizeof( char* ) );
+    for( size_t i = 0; i < oldCapacity; ++i ) {
+        if ( old[i] ) {
+            _slots[Slot( old[i], strlen( old[i] ) )] = old[i];
+        }
+    }
+    delete [] old;
+}
+
+
+const char* NameTable::Intern( const char* name, size_t length )
+{
+    TIXMLASSERT( name );
+    if ( ( _count + 1 ) * 2 > _capacity ) {
+        Grow();
+    }
+    const size_t slot = Slot( name, length );
+    if ( !_slots[slot] ) {
+        char* copy = new char[length+1];
+        memcpy( copy, name, length );
+        copy[length] = 0;
+        _slots[slot] = copy;
+        ++_count;
+    }
+    return _slots[slot];
+}
+
+
+const char* NameTable::Find( const char* name, size_t length ) const
+{
+    TIXMLASSERT( name );
+    if ( !_capacity ) {
+        return 0;
+    }
+    return _slots[Slot( name, length )];
+}
+
+
+void StrPair::InternName( NameTable* table )
+{
+    TIXMLASSERT( table );
+    TIXMLASSERT( !( _flags & NEEDS_DELETE ) );
+    SetInternedStr( table->Intern( _start, static_cast<size_t>( _end - _start ) ) );
+}
+
+
 // --------- XMLUtil ----------- //
 
+#ifdef TIXML_SSE2
+static inline int CountBits( unsigned v )
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount( v );
+#else
+    v = v - ( ( v >> 1 ) & 0x55555555u );
+    v = ( v & 0x33333333u ) + ( ( v >> 2 ) & 0x33333333u );
+    return static_cast<int>( ( ( ( v + ( v >> 4 ) ) & 0x0f0f0f0fu ) * 0x01010101u ) >> 24 );
+#endif
+}
+
+static inline int LowestBit( unsigned v )
+{
+    TIXMLASSERT( v );
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz( v );
+#else
+    unsigned long index;
+    _BitScanForward( &index, v );
+    return static_cast<int>( index );
+#endif
+}
+
+// Bits of the block bytes that are ' ', '\t', '\n', '\v', '\f' or '\r', the characters IsWhiteSpace accepts.
+static inline unsigned WhiteSpaceMask16( __m128i v )
+{
+    const __m128i control = _mm_sub_epi8( v, _mm_set1_epi8( '\t' ) );
+    const __m128i isControl = _mm_cmpeq_epi8( _mm_min_epu8( control, _mm_set1_epi8( '\r' - '\t' ) ), control );
+    return static_cast<unsigned>( _mm_movemask_epi8( _mm_or_si128( isControl, _mm_cmpeq_epi8( v, _mm_set1_epi8( ' ' ) ) ) ) );
+}
+
+static const char* ScanTextSSE2( const char* p, char endChar, int* lines )
+{
+    const __m128i stop = _mm_set1_epi8( endChar );
+    const __m128i newline = _mm_set1_epi8( '\n' );
+    const __m128i zero = _mm_setzero_si128();
+    const size_t misalign = reinterpret_cast<size_t>( p ) & 15;
+    const char* block = p - misalign;
+    unsigned skip = ( 1u << misalign ) - 1;
+    for( ;; ) {
+        const __m128i v = _mm_load_si128( reinterpret_cast<const __m128i*>( block ) );
+        const unsigned end = static_cast<unsigned>( _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( v, stop ), _mm_cmpeq_epi8( v, zero ) ) ) ) & ~skip;
+        const unsigned nl = static_cast<unsigned>( _mm_movemask_epi8( _mm_cmpeq_epi8( v, newline ) ) ) & ~skip;
+        if ( end ) {
+            *lines += CountBits( nl & ( ( end & ( 0u - end ) ) - 1 ) );
+            return block + LowestBit( end );
+        }
+        *lines += CountBits( nl );
+        block += 16;
+        skip = 0;
+    }
+}
+
+static const char* SkipWhiteSpaceSSE2( const char* p, int* lines )
+{
+    const __m128i newline = _mm_set1_epi8( '\n' );
+    const size_t misalign = reinterpret_cast<size_t>( p ) & 15;
+    const char* block = p - misalign;
+    unsigned skip = ( 1u << misalign ) - 1;
+    for( ;; ) {
+        const __m128i v = _mm_load_si128( reinterpret_cast<const __m128i*>( block ) );
+        const unsigned end = ~WhiteSpaceMask16( v ) & 0xffffu & ~skip;
+        const unsigned nl = static_cast<unsigned>( _mm_movemask_epi8( _mm_cmpeq_epi8( v, newline ) ) ) & ~skip;
+        if ( end ) {
+            *lines += CountBits( nl & ( ( end & ( 0u - end ) ) - 1 ) );
+            return block + LowestBit( end );
+        }
+        *lines += CountBits( nl );
+        block += 16;
+        skip = 0;
+    }
+}
+#endif
+
+#ifdef TIXML_AVX2
+__attribute__(( target( "avx2" ) ))
+static inline unsigned WhiteSpaceMask32( __m256i v )
+{
+    const __m256i control = _mm256_sub_epi8( v, _mm256_set1_epi8( '\t' ) );
+    const __m256i isControl = _mm256_cmpeq_epi8( _mm256_min_epu8( control, _mm256_set1_epi8( '\r' - '\t' ) ), control );
+    return static_cast<unsigned>( _mm256_movemask_epi8( _mm256_or_si256( isControl, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ' ' ) ) ) ) );
+}
+
+__attribute__(( target( "avx2,popcnt" ) ))
+static const char* ScanTextAVX2( const char* p, char endChar, int* lines )
+{
+    const __m256i stop = _mm256_set1_epi8( endChar );
+    const __m256i newline = _mm256_set1_epi8( '\n' );
+    const __m256i zero = _mm256_setzero_si256();
+    const size_t misalign = reinterpret_cast<size_t>( p ) & 31;
+    const char* block = p - misalign;
+    unsigned skip = ( 1u << misalign ) - 1;
+    for( ;; ) {
+        const __m256i v = _mm256_load_si256( reinterpret_cast<const __m256i*>( block ) );
+        const unsigned end = static_cast<unsigned>( _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( v, stop ), _mm256_cmpeq_epi8( v, zero ) ) ) ) & ~skip;
+        const unsigned nl = static_cast<unsigned>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, newline ) ) ) & ~skip;
+        if ( end ) {
+            *lines += __builtin_popcount( nl & ( ( end & ( 0u - end ) ) - 1 ) );
+            return block + __builtin_ctz( end );
+        }
+        *lines += __builtin_popcount( nl );
+        block += 32;
+        skip = 0;
+    }
+}
+
+__attribute__(( target( "avx2,popcnt" ) ))
+static const char* SkipWhiteSpaceAVX2( const char* p, int* lines )
+{
+    const __m256i newline = _mm256_set1_epi8( '\n' );
+    const size_t misalign = reinterpret_cast<size_t>( p ) & 31;
+    const char* block = p - misalign;
+    unsigned skip = ( 1u << misalign ) - 1;
+    for( ;; ) {
+        const __m256i v = _mm256_load_si256( reinterpret_cast<const __m256i*>( block ) );
+        const unsigned end = ~WhiteSpaceMask32( v ) & ~skip;
+        const unsigned nl = static_cast<unsigned>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, newline ) ) ) & ~skip;
+        if ( end ) {
+            *lines += __builtin_popcount( nl & ( ( end & ( 0u - end ) ) - 1 ) );
+            return block + __builtin_ctz( end );
+        }
+        *lines += __builtin_popcount( nl );
+        block += 32;
+        skip = 0;
+    }
+}
+
+static bool HasAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "popcnt" );
+}
+#endif
+
+#ifndef TIXML_SSE2
+static const char* ScanTextScalar( const char* p, char endChar, int* lines )
+{
+    while ( *p && *p != endChar ) {
+        if ( *p == '\n' ) {
+            ++(*lines);
+        }
+        ++p;
+    }
+    return p;
+}
+
+static const char* SkipWhiteSpaceScalar( const char* p, int* lines )
+{
+    while( XMLUtil::IsWhiteSpace(*p) ) {
+        if ( *p == '\n' ) {
+            ++(*lines);
+        }
+        ++p;
+    }
+    return p;
+}
+#endif
+
+typedef const char* (*ScanTextFn)( const char*, char, int* );
+typedef const char* (*SkipWhiteSpaceFn)( const char*, int* );
+
+// Picked on first use rather than at static initialization, so documents parsed by other
+// static constructors are safe.
+static ScanTextFn ScanTextImpl()
+{
+#if defined(TIXML_AVX2)
+    static const ScanTextFn impl = HasAVX2() ? ScanTextAVX2 : ScanTextSSE2;
+#elif defined(TIXML_SSE2)
+    static const ScanTextFn impl = ScanTextSSE2;
+#else
+    static const ScanTextFn impl = ScanTextScalar;
+#endif
+    return impl;
+}
+
+static SkipWhiteSpaceFn SkipWhiteSpaceImpl()
+{
+#if defined(TIXML_AVX2)
+    static const SkipWhiteSpaceFn impl = HasAVX2() ? SkipWhiteSpaceAVX2 : SkipWhiteSpaceSSE2;
+#elif defined(TIXML_SSE2)
+    static const SkipWhiteSpaceFn impl = SkipWhiteSpaceSSE2;
+#else
+    static const SkipWhiteSpaceFn impl = SkipWhiteSpaceScalar;
+#endif
+    return impl;
+}
+
+const char* XMLUtil::ScanText( const char* p, char endChar, int* curLineNumPtr )
+{
+    TIXMLASSERT( p );
+    int lines = 0;
+    p = ScanTextImpl()( p, endChar, &lines );
+    if ( curLineNumPtr ) {
+        *curLineNumPtr += lines;
+    }
+    return p;
+}
+
+const char* XMLUtil::SkipWhiteSpaceRun( const char* p, int* curLineNumPtr )
+{
+    TIXMLASSERT( p );
+    int lines = 0;
+    p = SkipWhiteSpaceImpl()( p, &lines );
+    if ( curLineNumPtr ) {
+        *curLineNumPtr += lines;
+    }
+    return p;
+}
+
 const char* XMLUtil::writeBoolTrue  = "true";
 const char* XMLUtil::writeBoolFalse = "false";
 
@@ -568,62 +902,260 @@ const char* XMLUtil::GetCharacterRef( const char* p, char* value, int* length )
 }
 
 
+// Decimal digits of v, written backwards from end two at a time; returns the first digit.
+static char* FormatDigits( uint64_t v, char* end )
+{
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char* p = end;
+    while ( v >= 100 ) {
+        const unsigned i = static_cast<unsigned>( v % 100 ) * 2;
+        v /= 100;
+        *--p = pairs[i+1];
+        *--p = pairs[i];
+    }
+    if ( v >= 10 ) {
+        const unsigned i = static_cast<unsigned>( v ) * 2;
+        *--p = pairs[i+1];
+        *--p = pairs[i];
+    }
+    else {
+        *--p = static_cast<char>( '0' + v );
+    }
+    return p;
+}
+
+// Copies the formatted text into buffer, cut short like snprintf when it does not fit.
+static void CopyFormatted( const char* text, size_t length, char* buffer, int bufferSize )
+{
+    if ( bufferSize <= 0 ) {
+        return;
+    }
+    if ( length >= static_cast<size_t>( bufferSize ) ) {
+        length = static_cast<size_t>( bufferSize ) - 1;
+    }
+    memcpy( buffer, text, length );
+    buffer[length] = 0;
+}
+
+static void FormatInteger( uint64_t magnitude, bool negative, char* buffer, int bufferSize )
+{
+    char text[24];
+    char* end = text + sizeof( text );
+    char* p = FormatDigits( magnitude, end );
+    if ( negative ) {
+        *--p = '-';
+    }
+    CopyFormatted( p, static_cast<size_t>( end - p ), buffer, bufferSize );
+}
+
 void XMLUtil::ToStr( int v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%d", v );
+    ToStr( static_cast<int64_t>( v ), buffer, bufferSize );
 }
 
 
 void XMLUtil::ToStr( unsigned v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%u", v );
+    FormatInteger( v, false, buffer, bufferSize );
 }
 
 
 void XMLUtil::ToStr( bool v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%s", v ? writeBoolTrue : writeBoolFalse);
+    const char* text = v ? writeBoolTrue : writeBoolFalse;
+    CopyFormatted( text, strlen( text ), buffer, bufferSize );
 }
 
 /*
 	ToStr() of a number is a very tricky topic.
 	https://github.com/leethomason/tinyxml2/issues/106
+
+	Where std::to_chars is available, floats and doubles are written as the shortest
+	text that reads back to the same value.
 */
 void XMLUtil::ToStr( float v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_FROM_CHARS
+    char text[64];
+    const std::to_chars_result result = std::to_chars( text, text + sizeof( text ), v );
+    CopyFormatted( text, static_cast<size_t>( result.ptr - text ), buffer, bufferSize );
+#else
     TIXML_SNPRINTF( buffer, bufferSize, "%.8g", v );
+#endif
 }
 
 
 void XMLUtil::ToStr( double v, char* buffer, int bufferSize )
 {
+#ifdef TIXML_FROM_CHARS
+    char text[64];
+    const std::to_chars_result result = std::to_chars( text, text + sizeof( text ), v );
+    CopyFormatted( text, static_cast<size_t>( result.ptr - text ), buffer, bufferSize );
+#else
     TIXML_SNPRINTF( buffer, bufferSize, "%.17g", v );
+#endif
 }
 
 
 void XMLUtil::ToStr( int64_t v, char* buffer, int bufferSize )
 {
-	// horrible syntax trick to make the compiler happy about %lld
-	TIXML_SNPRINTF(buffer, bufferSize, "%lld", static_cast<long long>(v));
+    const bool negative = v < 0;
+    const uint64_t magnitude = negative ? 0 - static_cast<uint64_t>( v ) : static_cast<uint64_t>( v );
+    FormatInteger( magnitude, negative, buffer, bufferSize );
 }
 
 void XMLUtil::ToStr( uint64_t v, char* buffer, int bufferSize )
 {
-    // horrible syntax trick to make the compiler happy about %llu
-    TIXML_SNPRINTF(buffer, bufferSize, "%llu", (long long)v);
+    FormatInteger( v, false, buffer, bufferSize );
+}
+
+// Integer scanning with the same acceptance as sscanf's %d, %u and %x (and their ll forms):
+// leading white space, an optional sign, for hex an optional 0x prefix, then digits; anything
+// after the digits is ignored. No locale, no allocation.
+static inline bool IsScanSpace( char c )
+{
+    return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+static inline int HexDigit( char c )
+{
+    if ( c >= '0' && c <= '9' ) {
+        return c - '0';
+    }
+    if ( c >= 'a' && c <= 'f' ) {
+        return c - 'a' + 10;
+    }
+    if ( c >= 'A' && c <= 'F' ) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Magnitude and sign of the number at str; *overflow is set when the magnitude does not fit in 64 bits.
+static bool ScanInteger( const char* str, bool hex, bool* negative, uint64_t* magnitude, bool* overflow )
+{
+    const char* p = str;
+    while ( IsScanSpace( *p ) ) {
+        ++p;
+    }
+    *negative = false;
+    if ( *p == '-' || *p == '+' ) {
+        *negative = ( *p == '-' );
+        ++p;
+    }
+    const unsigned base = hex ? 16 : 10;
+    if ( hex && *p == '0' && ( *(p+1) == 'x' || *(p+1) == 'X' ) ) {
+        p += 2;
+        if ( HexDigit( *p ) < 0 ) {
+            // sscanf takes a bare "0x" as zero
+            *magnitude = 0;
+            *overflow = false;
+            return true;
+        }
+    }
+    uint64_t v = 0;
+    bool over = false;
+    const char* digits = p;
+    for( ;; ++p ) {
+        const int d = hex ? HexDigit( *p ) : ( *p >= '0' && *p <= '9' ? *p - '0' : -1 );
+        if ( d < 0 ) {
+            break;
+        }
+        if ( v > ( UINT64_MAX - static_cast<unsigned>(d) ) / base ) {
+            over = true;
+        }
+        v = v * base + static_cast<unsigned>(d);
+    }
+    if ( p == digits ) {
+        return false;
+    }
+    *magnitude = v;
+    *overflow = over;
+    return true;
+}
+
+// As strtoll: out of range values saturate.
+static bool ScanSigned( const char* str, int64_t* value )
+{
+    bool negative, overflow;
+    uint64_t magnitude;
+    if ( !ScanInteger( str, false, &negative, &magnitude, &overflow ) ) {
+        return false;
+    }
+    const uint64_t limit = negative ? static_cast<uint64_t>(INT64_MAX) + 1 : static_cast<uint64_t>(INT64_MAX);
+    if ( overflow || magnitude > limit ) {
+        *value = negative ? INT64_MIN : INT64_MAX;
+    }
+    else {
+        *value = negative ? static_cast<int64_t>( 0 - magnitude ) : static_cast<int64_t>( magnitude );
+    }
+    return true;
+}
+
+// As strtoull: a minus sign negates modulo 2^64, out of range values saturate.
+static bool ScanUnsigned( const char* str, bool hex, uint64_t* value )
+{
+    bool negative, overflow;
+    uint64_t magnitude;
+    if ( !ScanInteger( str, hex, &negative, &magnitude, &overflow ) ) {
+        return false;
+    }
+    if ( overflow ) {
+        *value = UINT64_MAX;
+    }
+    else {
+        *value = negative ? 0 - magnitude : magnitude;
+    }
+    return true;
+}
+
+#ifdef TIXML_FROM_CHARS
+// Plain decimal numbers go through from_chars. Hex floats, infinities, NaNs and out of range
+// values are rare enough to leave to sscanf, which returns false here.
+template< class T >
+static bool ScanDecimal( const char* str, T* value )
+{
+    const char* p = str;
+    while ( IsScanSpace( *p ) ) {
+        ++p;
+    }
+    bool negative = false;
+    if ( *p == '-' || *p == '+' ) {
+        negative = ( *p == '-' );
+        ++p;
+    }
+    if ( !( *p >= '0' && *p <= '9' ) && *p != '.' ) {
+        return false;
+    }
+    if ( *p == '0' && ( *(p+1) == 'x' || *(p+1) == 'X' ) ) {
+        return false;
+    }
+    T v = 0;
+    const std::from_chars_result result = std::from_chars( p, p + strlen( p ), v, std::chars_format::general );
+    if ( result.ec != std::errc() ) {
+        return false;
+    }
+    *value = negative ? -v : v;
+    return true;
 }
+#endif
 
 bool XMLUtil::ToInt(const char* str, int* value)
 {
     if (IsPrefixHex(str)) {
-        unsigned v;
-        if (TIXML_SSCANF(str, "%x", &v) == 1) {
-            *value = static_cast<int>(v);
+        uint64_t v;
+        if (ScanUnsigned(str, true, &v)) {
+            *value = static_cast<int>(static_cast<unsigned>(v));
             return true;
         }
     }
     else {
-        if (TIXML_SSCANF(str, "%d", value) == 1) {
+        int64_t v;
+        if (ScanSigned(str, &v)) {
+            *value = static_cast<int>(v);
             return true;
         }
     }
@@ -632,7 +1164,9 @@ bool XMLUtil::ToInt(const char* str, int* value)
 
 bool XMLUtil::ToUnsigned(const char* str, unsigned* value)
 {
-    if (TIXML_SSCANF(str, IsPrefixHex(str) ? "%x" : "%u", value) == 1) {
+    uint64_t v;
+    if (ScanUnsigned(str, IsPrefixHex(str), &v)) {
+        *value = static_cast<unsigned>(v);
         return true;
     }
     return false;
@@ -640,32 +1174,41 @@ bool XMLUtil::ToUnsigned(const char* str, unsigned* value)
 
 bool XMLUtil::ToBool( const char* str, bool* value )
 {
+    // The literals first: none of them can be read as a number.
+    switch ( *str ) {
+        case 't':
+        case 'T':
+            if ( StringEqual( str, "true" ) || StringEqual( str, "True" ) || StringEqual( str, "TRUE" ) ) {
+                *value = true;
+                return true;
+            }
+            return false;
+        case 'f':
+        case 'F':
+            if ( StringEqual( str, "false" ) || StringEqual( str, "False" ) || StringEqual( str, "FALSE" ) ) {
+                *value = false;
+                return true;
+            }
+            return false;
+        default:
+            break;
+    }
     int ival = 0;
     if ( ToInt( str, &ival )) {
         *value = (ival==0) ? false : true;
         return true;
     }
-    static const char* TRUE_VALS[] = { "true", "True", "TRUE", 0 };
-    static const char* FALSE_VALS[] = { "false", "False", "FALSE", 0 };
-
-    for (int i = 0; TRUE_VALS[i]; ++i) {
-        if (StringEqual(str, TRUE_VALS[i])) {
-            *value = true;
-            return true;
-        }
-    }
-    for (int i = 0; FALSE_VALS[i]; ++i) {
-        if (StringEqual(str, FALSE_VALS[i])) {
-            *value = false;
-            return true;
-        }
-    }
     return false;
 }
 
 
 bool XMLUtil::ToFloat( const char* str, float* value )
 {
+#ifdef TIXML_FROM_CHARS
+    if ( ScanDecimal( str, value ) ) {
+        return true;
+    }
+#endif
     if ( TIXML_SSCANF( str, "%f", value ) == 1 ) {
         return true;
     }
@@ -675,6 +1218,11 @@ bool XMLUtil::ToFloat( const char* str, float* value )
 
 bool XMLUtil::ToDouble( const char* str, double* value )
 {
+#ifdef TIXML_FROM_CHARS
+    if ( ScanDecimal( str, value ) ) {
+        return true;
+    }
+#endif
     if ( TIXML_SSCANF( str, "%lf", value ) == 1 ) {
         return true;
     }
@@ -685,16 +1233,14 @@ bool XMLUtil::ToDouble( const char* str, double* value )
 bool XMLUtil::ToInt64(const char* str, int64_t* value)
 {
     if (IsPrefixHex(str)) {
-        unsigned long long v = 0;	// horrible syntax trick to make the compiler happy about %llx
-        if (TIXML_SSCANF(str, "%llx", &v) == 1) {
+        uint64_t v;
+        if (ScanUnsigned(str, true, &v)) {
             *value = static_cast<int64_t>(v);
             return true;
         }
     }
     else {
-        long long v = 0;	// horrible syntax trick to make the compiler happy about %lld
-        if (TIXML_SSCANF(str, "%lld", &v) == 1) {
-            *value = static_cast<int64_t>(v);
+        if (ScanSigned(str, value)) {
             return true;
         }
     }
@@ -703,12 +1249,7 @@ bool XMLUtil::ToInt64(const char* str, int64_t* value)
 
 
 bool XMLUtil::ToUnsigned64(const char* str, uint64_t* value) {
-    unsigned long long v = 0;	// horrible syntax trick to make the compiler happy about %llu
-    if(TIXML_SSCANF(str, IsPrefixHex(str) ? "%llx" : "%llu", &v) == 1) {
-        *value = (uint64_t)v;
-        return true;
-    }
-    return false;
+    return ScanUnsigned(str, IsPrefixHex(str), value);
 }
 
 
@@ -867,7 +1408,10 @@ const char* XMLNode::Value() const
 
 void XMLNode::SetValue( const char* str, bool staticMem )
 {
-    if ( staticMem ) {
+    if ( _document && _document->_internNames && ToElement() ) {
+        _value.SetInternedStr( _document->Intern( str ).Str() );
+    }
+    else if ( staticMem ) {
         _value.SetInternedStr( str );
     }
     else {
@@ -1034,6 +1578,18 @@ XMLNode* XMLNode::InsertAfterChild( XMLNode* afterThis, XMLNode* addThis )
 
 
 
+const XMLElement* XMLNode::FirstChildElement( const XMLName& name ) const
+{
+    for( const XMLNode* node = _firstChild; node; node = node->_next ) {
+        const XMLElement* element = node->ToElementWithName( name );
+        if ( element ) {
+            return element;
+        }
+    }
+    return 0;
+}
+
+
 const XMLElement* XMLNode::FirstChildElement( const char* name ) const
 {
     for( const XMLNode* node = _firstChild; node; node = node->_next ) {
@@ -1046,6 +1602,18 @@ const XMLElement* XMLNode::FirstChildElement( const char* name ) const
 }
 
 
+const XMLElement* XMLNode::LastChildElement( const XMLName& name ) const
+{
+    for( const XMLNode* node = _lastChild; node; node = node->_prev ) {
+        const XMLElement* element = node->ToElementWithName( name );
+        if ( element ) {
+            return element;
+        }
+    }
+    return 0;
+}
+
+
 const XMLElement* XMLNode::LastChildElement( const char* name ) const
 {
     for( const XMLNode* node = _lastChild; node; node = node->_prev ) {
@@ -1058,7 +1626,7 @@ const XMLElement* XMLNode::LastChildElement( const char* name ) const
 }
 
 
-const XMLElement* XMLNode::NextSiblingElement( const char* name ) const
+const XMLElement* XMLNode::NextSiblingElement( const XMLName& name ) const
 {
     for( const XMLNode* node = _next; node; node = node->_next ) {
         const XMLElement* element = node->ToElementWithName( name );
@@ -1070,9 +1638,9 @@ const XMLElement* XMLNode::NextSiblingElement( const char* name ) const
 }
 
 
-const XMLElement* XMLNode::PreviousSiblingElement( const char* name ) const
+const XMLElement* XMLNode::NextSiblingElement( const char* name ) const
 {
-    for( const XMLNode* node = _prev; node; node = node->_prev ) {
+    for( const XMLNode* node = _next; node; node = node->_next ) {
         const XMLElement* element = node->ToElementWithName( name );
         if ( element ) {
             return element;
@@ -1082,12 +1650,36 @@ const XMLElement* XMLNode::PreviousSiblingElement( const char* name ) const
 }
 
 
-char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
+const XMLElement* XMLNode::PreviousSiblingElement( const XMLName& name ) const
 {
-    // This is a recursive method, but thinking about it "at the current level"
-    // it is a pretty simple flat list:
-    //		<foo/>
-    //		<!-- comment -->
+    for( const XMLNode* node = _prev; node; node = node->_prev ) {
+        const XMLElement* element = node->ToElementWithName( name );
+        if ( element ) {
+            return element;
+        }
+    }
+    return 0;
+}
+
+
+const XMLElement* XMLNode::PreviousSiblingElement( const char* name ) const
+{
+    for( const XMLNode* node = _prev; node; node = node->_prev ) {
+        const XMLElement* element = node->ToElementWithName( name );
+        if ( element ) {
+            return element;
+        }
+    }
+    return 0;
+}
+
+
+char* XMLNode::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr )
+{
+    // This is a recursive method, but thinking about it "at the current level"
+    // it is a pretty simple flat list:
+    //		<foo/>
+    //		<!-- comment -->
     //
     // With a special case:
     //		<foo>
@@ -1242,6 +1834,19 @@ const XMLElement* XMLNode::ToElementWithName( const char* name ) const
     return 0;
 }
 
+const XMLElement* XMLNode::ToElementWithName( const XMLName& name ) const
+{
+    const XMLElement* element = this->ToElement();
+    if ( element == 0 ) {
+        return 0;
+    }
+    const char* elementName = element->_value.GetStr();
+    if ( _document->_internNames ? elementName == name.Str() : XMLUtil::StringEqual( elementName, name.Str() ) ) {
+        return element;
+    }
+    return 0;
+}
+
 // --------- XMLText ---------- //
 char* XMLText::ParseDeep( char* p, StrPair*, int* curLineNumPtr )
 {
@@ -1626,6 +2231,18 @@ XMLElement::~XMLElement()
 }
 
 
+const XMLAttribute* XMLElement::FindAttribute( const XMLName& name ) const
+{
+    for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
+        const char* attributeName = a->_name.GetStr();
+        if ( _document->_internNames ? attributeName == name.Str() : XMLUtil::StringEqual( attributeName, name.Str() ) ) {
+            return a;
+        }
+    }
+    return 0;
+}
+
+
 const XMLAttribute* XMLElement::FindAttribute( const char* name ) const
 {
     for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
@@ -1649,6 +2266,77 @@ const char* XMLElement::Attribute( const char* name, const char* value ) const
     return 0;
 }
 
+const char* XMLSaxAttributes::Attribute( const char* name, const char* value ) const
+{
+    for ( int i = 0; i < _count; ++i ) {
+        if ( XMLUtil::StringEqual( _pairs[2*i], name ) ) {
+            const char* found = _pairs[2*i+1];
+            return ( !value || XMLUtil::StringEqual( found, value ) ) ? found : 0;
+        }
+    }
+    return 0;
+}
+
+int XMLSaxAttributes::IntAttribute( const char* name, int defaultValue ) const
+{
+    const char* value = Attribute( name );
+    int i = defaultValue;
+    if ( value ) {
+        XMLUtil::ToInt( value, &i );
+    }
+    return i;
+}
+
+unsigned XMLSaxAttributes::UnsignedAttribute( const char* name, unsigned defaultValue ) const
+{
+    const char* value = Attribute( name );
+    unsigned i = defaultValue;
+    if ( value ) {
+        XMLUtil::ToUnsigned( value, &i );
+    }
+    return i;
+}
+
+int64_t XMLSaxAttributes::Int64Attribute( const char* name, int64_t defaultValue ) const
+{
+    const char* value = Attribute( name );
+    int64_t i = defaultValue;
+    if ( value ) {
+        XMLUtil::ToInt64( value, &i );
+    }
+    return i;
+}
+
+bool XMLSaxAttributes::BoolAttribute( const char* name, bool defaultValue ) const
+{
+    const char* value = Attribute( name );
+    bool b = defaultValue;
+    if ( value ) {
+        XMLUtil::ToBool( value, &b );
+    }
+    return b;
+}
+
+double XMLSaxAttributes::DoubleAttribute( const char* name, double defaultValue ) const
+{
+    const char* value = Attribute( name );
+    double d = defaultValue;
+    if ( value ) {
+        XMLUtil::ToDouble( value, &d );
+    }
+    return d;
+}
+
+float XMLSaxAttributes::FloatAttribute( const char* name, float defaultValue ) const
+{
+    const char* value = Attribute( name );
+    float f = defaultValue;
+    if ( value ) {
+        XMLUtil::ToFloat( value, &f );
+    }
+    return f;
+}
+
 int XMLElement::IntAttribute(const char* name, int defaultValue) const
 {
 	int i = defaultValue;
@@ -1944,7 +2632,12 @@ XMLAttribute* XMLElement::FindOrCreateAttribute( const char* name )
             TIXMLASSERT( _rootAttribute == 0 );
             _rootAttribute = attrib;
         }
-        attrib->SetName( name );
+        if ( _document->_internNames ) {
+            attrib->_name.SetInternedStr( _document->Intern( name ).Str() );
+        }
+        else {
+            attrib->SetName( name );
+        }
     }
     return attrib;
 }
@@ -1990,6 +2683,9 @@ char* XMLElement::ParseAttributes( char* p, int* curLineNumPtr )
             const int attrLineNum = attrib->_parseLineNum;
 
             p = attrib->ParseDeep( p, _document->ProcessEntities(), curLineNumPtr );
+            if ( p && _document->_internNames ) {
+                attrib->_name.InternName( &_document->_names );
+            }
             if ( !p || Attribute( attrib->Name() ) ) {
                 DeleteAttribute( attrib );
                 _document->SetError( XML_ERROR_PARSING_ATTRIBUTE, attrLineNum, "XMLElement name=%s", Name() );
@@ -2102,6 +2798,10 @@ char* XMLElement::ParseDeep( char* p, StrPair* parentEndTag, int* curLineNumPtr
     if ( _value.Empty() ) {
         return 0;
     }
+    // Closing tags are only compared with their element, so they keep the text in the buffer.
+    if ( _document->_internNames && _closingType != CLOSING ) {
+        _value.InternName( &_document->_names );
+    }
 
     p = ParseAttributes( p, curLineNumPtr );
     if ( !p || !*p || _closingType != OPEN ) {
@@ -2193,15 +2893,30 @@ const char* XMLDocument::_errorNames[XML_ERROR_COUNT] = {
 };
 
 
-XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
+XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode, bool internNames ) :
     XMLNode( 0 ),
     _writeBOM( false ),
     _processEntities( processEntities ),
     _errorID(XML_SUCCESS),
     _whitespaceMode( whitespaceMode ),
+    _internNames( internNames ),
+    _names(),
     _errorStr(),
     _errorLineNum( 0 ),
     _charBuffer( 0 ),
+    _charBufferSize( 0 ),
+    _charBufferMapSize( 0 ),
+    _retainMemory( false ),
+    _retainedBuffer( 0 ),
+    _retainedBufferSize( 0 ),
+    _documentBytes( 0 ),
+    _elementDensity( 0 ),
+    _attributeDensity( 0 ),
+    _textDensity( 0 ),
+    _commentDensity( 0 ),
+    _saxHandler( 0 ),
+    _parseThreads( 1 ),
+    _partitions(),
     _parseCurLineNum( 0 ),
 	_parsingDepth(0),
     _unlinked(),
@@ -2218,6 +2933,79 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
 XMLDocument::~XMLDocument()
 {
     Clear();
+    for ( int i = 0; i < _partitions.Size(); ++i ) {
+        delete _partitions[i];
+    }
+    delete [] _retainedBuffer;
+}
+
+
+void XMLDocument::SetRetainMemory( bool retainMemory )
+{
+    _retainMemory = retainMemory;
+    if ( !_retainMemory ) {
+        delete [] _retainedBuffer;
+        _retainedBuffer = 0;
+        _retainedBufferSize = 0;
+    }
+}
+
+
+void XMLDocument::SetPoolBlockSize( int bytes )
+{
+    _elementPool.SetBlockSize( bytes );
+    _attributePool.SetBlockSize( bytes );
+    _textPool.SetBlockSize( bytes );
+    _commentPool.SetBlockSize( bytes );
+}
+
+
+static int ScaleDensity( double density, size_t bytes )
+{
+    const double count = density * static_cast<double>( bytes );
+    return count < INT_MAX ? static_cast<int>( count ) : INT_MAX;
+}
+
+
+void XMLDocument::Reserve( size_t documentBytes )
+{
+    _elementPool.Reserve( ScaleDensity( _elementDensity, documentBytes ) );
+    _attributePool.Reserve( ScaleDensity( _attributeDensity, documentBytes ) );
+    _textPool.Reserve( ScaleDensity( _textDensity, documentBytes ) );
+    _commentPool.Reserve( ScaleDensity( _commentDensity, documentBytes ) );
+}
+
+
+// Buffer for size bytes of text and the terminator; with retainMemory the previous one
+// is reused when it is big enough.
+char* XMLDocument::AllocateBuffer( size_t size )
+{
+    TIXMLASSERT( _charBuffer == 0 );
+    if ( _retainedBuffer && _retainedBufferSize > size ) {
+        _charBuffer = _retainedBuffer;
+        _charBufferSize = _retainedBufferSize;
+        _retainedBuffer = 0;
+        _retainedBufferSize = 0;
+    }
+    else {
+        delete [] _retainedBuffer;
+        _retainedBuffer = 0;
+        _retainedBufferSize = 0;
+        _charBuffer = new char[size+1];
+        _charBufferSize = size+1;
+    }
+    if ( _retainMemory && !_saxHandler && _parseThreads == 1 ) {
+        Reserve( size );
+        _documentBytes = size;
+    }
+    return _charBuffer;
+}
+
+
+XMLName XMLDocument::Intern( const char* name )
+{
+    TIXMLASSERT( name );
+    return XMLName( _names.Intern( name, strlen( name ) ) );
 }
 
 
@@ -2236,18 +3024,54 @@ void XMLDocument::MarkInUse(const XMLNode* const node)
 
 void XMLDocument::Clear()
 {
+    // The nodes the document ended up with size the pools for the next one.
+    if ( _documentBytes ) {
+        const double bytes = static_cast<double>( _documentBytes );
+        _elementDensity = _elementPool.CurrentAllocs() / bytes;
+        _attributeDensity = _attributePool.CurrentAllocs() / bytes;
+        _textDensity = _textPool.CurrentAllocs() / bytes;
+        _commentDensity = _commentPool.CurrentAllocs() / bytes;
+        _documentBytes = 0;
+    }
     DeleteChildren();
 	while( _unlinked.Size()) {
 		DeleteNode(_unlinked[0]);	// Will remove from _unlinked as part of delete.
 	}
+    // The nodes of a parallel parse are gone, so their pools can be cleared too.
+    for ( int i = 0; i < _partitions.Size(); ++i ) {
+        if ( _retainMemory ) {
+            _partitions[i]->Clear();
+        }
+        else {
+            delete _partitions[i];
+        }
+    }
+    if ( !_retainMemory ) {
+        _partitions.Clear();
+    }
 
 #ifdef TINYXML2_DEBUG
     const bool hadError = Error();
 #endif
     ClearError();
 
-    delete [] _charBuffer;
+#ifdef TIXML_USE_MMAP
+    if ( _charBufferMapSize ) {
+        munmap( _charBuffer, _charBufferMapSize );
+        _charBuffer = 0;
+        _charBufferMapSize = 0;
+    }
+#endif
+    if ( _retainMemory && _charBuffer && _charBufferSize > _retainedBufferSize ) {
+        delete [] _retainedBuffer;
+        _retainedBuffer = _charBuffer;
+        _retainedBufferSize = _charBufferSize;
+    }
+    else {
+        delete [] _charBuffer;
+    }
     _charBuffer = 0;
+    _charBufferSize = 0;
 	_parsingDepth = 0;
 
 #if 0
@@ -2373,10 +3197,56 @@ XMLError XMLDocument::LoadFile( const char* filename )
     return _errorID;
 }
 
+bool XMLDocument::MapFile( FILE* fp )
+{
+#ifdef TIXML_USE_MMAP
+    const int fd = fileno( fp );
+    struct stat st;
+    if ( fd < 0 || fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) || st.st_size <= 0 ) {
+        return false;
+    }
+    const size_t size = static_cast<size_t>( st.st_size );
+    const size_t page = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+    if ( size >= static_cast<size_t>(-1) - page ) {
+        return false;
+    }
+    // Reserve zeroed memory one byte past the file, rounded to whole pages, and map the file over
+    // its start. The parser needs a null terminator and writes into the buffer; both stay private.
+    const size_t mapSize = ( size + 1 + page - 1 ) / page * page;
+    void* region = mmap( 0, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( region == MAP_FAILED ) {
+        return false;
+    }
+    if ( mmap( region, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+        munmap( region, mapSize );
+        return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise( region, size, MADV_SEQUENTIAL );
+#endif
+    TIXMLASSERT( _charBuffer == 0 );
+    _charBuffer = static_cast<char*>( region );
+    _charBufferMapSize = mapSize;
+    return true;
+#else
+    (void)fp;
+    return false;
+#endif
+}
+
 XMLError XMLDocument::LoadFile( FILE* fp )
 {
     Clear();
 
+    if ( MapFile( fp ) ) {
+        if ( _retainMemory && !_saxHandler && _parseThreads == 1 ) {
+            Reserve( _charBufferMapSize );
+            _documentBytes = _charBufferMapSize;
+        }
+        Parse();
+        return _errorID;
+    }
+
     TIXML_FSEEK( fp, 0, SEEK_SET );
     if ( fgetc( fp ) == EOF && ferror( fp ) != 0 ) {
         SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
@@ -2412,8 +3282,7 @@ XMLError XMLDocument::LoadFile( FILE* fp )
     }
 
     const size_t size = static_cast<size_t>(filelength);
-    TIXMLASSERT( _charBuffer == 0 );
-    _charBuffer = new char[size+1];
+    AllocateBuffer( size );
     const size_t read = fread( _charBuffer, 1, size, fp );
     if ( read != size ) {
         SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
@@ -2468,21 +3337,46 @@ XMLError XMLDocument::Parse( const char* xml, size_t nBytes )
     if ( nBytes == static_cast<size_t>(-1) ) {
         nBytes = strlen( xml );
     }
-    TIXMLASSERT( _charBuffer == 0 );
-    _charBuffer = new char[ nBytes+1 ];
-    memcpy( _charBuffer, xml, nBytes );
-    _charBuffer[nBytes] = 0;
+    return ParseParts( 0, 0, xml, nBytes, 0, 0, 1 );
+}
 
-    Parse();
+
+// Parses head, body and tail as one document whose first line is lineNum.
+XMLError XMLDocument::ParseParts( const char* head, size_t headBytes, const char* body, size_t bodyBytes,
+                                  const char* tail, size_t tailBytes, int lineNum )
+{
+    Clear();
+    const size_t size = headBytes + bodyBytes + tailBytes;
+    AllocateBuffer( size );
+    if ( headBytes ) {
+        memcpy( _charBuffer, head, headBytes );
+    }
+    if ( bodyBytes ) {
+        memcpy( _charBuffer + headBytes, body, bodyBytes );
+    }
+    if ( tailBytes ) {
+        memcpy( _charBuffer + headBytes + bodyBytes, tail, tailBytes );
+    }
+    _charBuffer[size] = 0;
+
+    Parse( lineNum );
     if ( Error() ) {
         // clean up now essentially dangling memory.
         // and the parse fail can put objects in the
         // pools that are dead and inaccessible.
         DeleteChildren();
-        _elementPool.Clear();
-        _attributePool.Clear();
-        _textPool.Clear();
-        _commentPool.Clear();
+        if ( _retainMemory ) {
+            _elementPool.Reset();
+            _attributePool.Reset();
+            _textPool.Reset();
+            _commentPool.Reset();
+        }
+        else {
+            _elementPool.Clear();
+            _attributePool.Clear();
+            _textPool.Clear();
+            _commentPool.Clear();
+        }
     }
     return _errorID;
 }
@@ -2559,12 +3453,12 @@ const char* XMLDocument::ErrorName() const
     return ErrorIDToName(_errorID);
 }
 
-void XMLDocument::Parse()
+void XMLDocument::Parse( int lineNum )
 {
     TIXMLASSERT( NoChildren() ); // Clear() must have been called previously
     TIXMLASSERT( _charBuffer );
-    _parseCurLineNum = 1;
-    _parseLineNum = 1;
+    _parseCurLineNum = lineNum;
+    _parseLineNum = lineNum;
     char* p = _charBuffer;
     p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
     p = const_cast<char*>( XMLUtil::ReadBOM( p, &_writeBOM ) );
@@ -2572,9 +3466,507 @@ void XMLDocument::Parse()
         SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
         return;
     }
+    if ( _saxHandler ) {
+        ParseSax( p );
+        return;
+    }
+    if ( ParseParallel( p ) ) {
+        return;
+    }
     ParseDeep(p, 0, &_parseCurLineNum );
 }
 
+
+static char* SkipName( char* p )
+{
+    if ( !XMLUtil::IsNameStartChar( static_cast<unsigned char>( *p ) ) ) {
+        return p;
+    }
+    ++p;
+    while ( *p && XMLUtil::IsNameChar( static_cast<unsigned char>( *p ) ) ) {
+        ++p;
+    }
+    return p;
+}
+
+
+// Reads the document in the buffer as events for the SAX handler. It is read as
+// the DOM is, but names and values are terminated and decoded in place and
+// nothing else is kept but the names of the open elements.
+void XMLDocument::ParseSax( char* p )
+{
+    TIXMLASSERT( _saxHandler );
+    DynArray<const char*, 16> open;
+    DynArray<const char*, 32> attributes;	// name and value of each attribute
+    int textFlags = _processEntities ? StrPair::TEXT_ELEMENT : StrPair::TEXT_ELEMENT_LEAVE_ENTITIES;
+    if ( _whitespaceMode == COLLAPSE_WHITESPACE ) {
+        textFlags |= StrPair::NEEDS_WHITESPACE_COLLAPSING;
+    }
+    const int attributeFlags = _processEntities ? StrPair::ATTRIBUTE_VALUE : StrPair::ATTRIBUTE_VALUE_LEAVE_ENTITIES;
+    bool first = true;		// nothing read yet in the innermost element
+    bool prolog = true;		// nothing but declarations read yet
+
+    while ( true ) {
+        // Text up to the next markup. Whitespace alone is not text, but for
+        // pedantic whitespace when it is all there is in an element.
+        const int startLine = _parseCurLineNum;
+        char* const start = p;
+        p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+        if ( !*p ) {
+            break;
+        }
+        if ( *p != '<' || ( _whitespaceMode == PEDANTIC_WHITESPACE && first && p != start && p[1] == '/' ) ) {
+            const int lineNum = _parseCurLineNum;
+            _parseCurLineNum = startLine;
+            StrPair text;
+            p = text.ParseText( start, "<", textFlags, &_parseCurLineNum );
+            if ( !p ) {
+                SetError( XML_ERROR_PARSING_TEXT, lineNum, 0 );
+                return;
+            }
+            first = prolog = false;
+            if ( !_saxHandler->Text( text.GetStr(), false ) ) {
+                return;
+            }
+            --p;	// at the '<', which the text is now terminated with
+        }
+
+        const int lineNum = _parseCurLineNum;
+        if ( p[1] == '?' ) {
+            StrPair value;
+            p = value.ParseText( p+2, "?>", StrPair::NEEDS_NEWLINE_NORMALIZATION, &_parseCurLineNum );
+            if ( !p || !prolog || !open.Empty() ) {
+                SetError( XML_ERROR_PARSING_DECLARATION, lineNum, 0 );
+                return;
+            }
+            continue;
+        }
+        if ( XMLUtil::StringEqual( p+1, "!--", 3 ) ) {
+            StrPair value;
+            p = value.ParseText( p+4, "-->", StrPair::COMMENT, &_parseCurLineNum );
+            if ( !p ) {
+                SetError( XML_ERROR_PARSING_COMMENT, lineNum, 0 );
+                return;
+            }
+            first = prolog = false;
+            continue;
+        }
+        if ( XMLUtil::StringEqual( p+1, "![CDATA[", 8 ) ) {
+            StrPair text;
+            p = text.ParseText( p+9, "]]>", StrPair::NEEDS_NEWLINE_NORMALIZATION, &_parseCurLineNum );
+            if ( !p ) {
+                SetError( XML_ERROR_PARSING_CDATA, lineNum, 0 );
+                return;
+            }
+            first = prolog = false;
+            if ( !_saxHandler->Text( text.GetStr(), true ) ) {
+                return;
+            }
+            continue;
+        }
+        if ( p[1] == '!' ) {
+            StrPair value;
+            p = value.ParseText( p+2, ">", StrPair::NEEDS_NEWLINE_NORMALIZATION, &_parseCurLineNum );
+            if ( !p ) {
+                SetError( XML_ERROR_PARSING_UNKNOWN, lineNum, 0 );
+                return;
+            }
+            first = prolog = false;
+            continue;
+        }
+
+        p = XMLUtil::SkipWhiteSpace( p+1, &_parseCurLineNum );
+        const bool closing = *p == '/';
+        if ( closing ) {
+            ++p;
+        }
+        char* const name = p;
+        char* const nameEnd = SkipName( p );
+        if ( nameEnd == name ) {
+            SetError( XML_ERROR_PARSING, lineNum, 0 );
+            return;
+        }
+        p = nameEnd;
+
+        if ( closing ) {
+            p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+            if ( *p != '>' ) {
+                SetError( XML_ERROR_PARSING_ELEMENT, lineNum, 0 );
+                return;
+            }
+            ++p;
+            const size_t length = nameEnd - name;
+            if ( open.Empty() || strncmp( open.PeekTop(), name, length ) != 0 || open.PeekTop()[length] ) {
+                SetError( XML_ERROR_MISMATCHED_ELEMENT, lineNum, 0 );
+                return;
+            }
+            first = false;
+            if ( !_saxHandler->EndElement( open.Pop() ) ) {
+                return;
+            }
+            continue;
+        }
+
+        // The name of an attribute is terminated once its '=' has been read, the
+        // name of the element at the end of the tag.
+        attributes.Clear();
+        bool empty = false;
+        while ( true ) {
+            p = XMLUtil::SkipWhiteSpace( p, &_parseCurLineNum );
+            if ( XMLUtil::IsNameStartChar( static_cast<unsigned char>( *p ) ) ) {
+                const int attributeLine = _parseCurLineNum;
+                char* const attributeName = p;
+                char* const attributeEnd = SkipName( p );
+                p = XMLUtil::SkipWhiteSpace( attributeEnd, &_parseCurLineNum );
+                if ( *p == '=' ) {
+                    *attributeEnd = 0;
+                    p = XMLUtil::SkipWhiteSpace( p+1, &_parseCurLineNum );
+                }
+                StrPair value;
+                if ( *attributeEnd || ( *p != '\"' && *p != '\'' ) ) {
+                    p = 0;
+                }
+                else {
+                    const char quote[2] = { *p, 0 };
+                    p = value.ParseText( p+1, quote, attributeFlags, &_parseCurLineNum );
+                }
+                for ( int i = 0; p && i < attributes.Size(); i += 2 ) {
+                    if ( XMLUtil::StringEqual( attributes[i], attributeName ) ) {
+                        p = 0;
+                    }
+                }
+                if ( !p ) {
+                    SetError( XML_ERROR_PARSING_ATTRIBUTE, attributeLine, 0 );
+                    return;
+                }
+                attributes.Push( attributeName );
+                attributes.Push( value.GetStr() );
+            }
+            else if ( *p == '>' ) {
+                ++p;
+                break;
+            }
+            else if ( *p == '/' && p[1] == '>' ) {
+                p += 2;
+                empty = true;
+                break;
+            }
+            else {
+                SetError( XML_ERROR_PARSING_ELEMENT, lineNum, 0 );
+                return;
+            }
+        }
+        *nameEnd = 0;
+
+        first = prolog = false;
+        if ( !_saxHandler->StartElement( name, XMLSaxAttributes( attributes.Mem(), attributes.Size() / 2 ) ) ) {
+            return;
+        }
+        if ( empty ) {
+            if ( !_saxHandler->EndElement( name ) ) {
+                return;
+            }
+        }
+        else {
+            open.Push( name );
+            first = true;
+            if ( open.Size() + 1 >= TINYXML2_MAX_ELEMENT_DEPTH ) {
+                SetError( XML_ELEMENT_DEPTH_EXCEEDED, _parseCurLineNum, "Element nesting is too deep." );
+                return;
+            }
+        }
+    }
+    // As from the DOM: an element left open is a mismatch, an element inside it a parse error.
+    if ( !open.Empty() ) {
+        SetError( open.Size() == 1 ? XML_ERROR_MISMATCHED_ELEMENT : XML_ERROR_PARSING, _parseCurLineNum, 0 );
+    }
+}
+
+
+#ifdef TIXML_USE_THREADS
+// Parallel parses split no finer than this.
+static const size_t MIN_PARTITION_BYTES = 256 * 1024;
+
+// Runs task( i ) for every i below count, all but the first on threads of their own.
+template<class Task>
+static void RunOnThreads( int count, const Task& task )
+{
+    std::thread* threads = new std::thread[count];
+    for ( int i = 1; i < count; ++i ) {
+        threads[i] = std::thread( task, i );
+    }
+    task( 0 );
+    for ( int i = 1; i < count; ++i ) {
+        threads[i].join();
+    }
+    delete [] threads;
+}
+#endif
+
+
+static int CountLines( const char* p, const char* end )
+{
+    int lines = 0;
+    while ( ( p = static_cast<const char*>( memchr( p, '\n', static_cast<size_t>( end - p ) ) ) ) != 0 ) {
+        ++lines;
+        ++p;
+    }
+    return lines;
+}
+
+
+// Skips comments, and whitespace around them. Null if a comment does not end.
+static char* SkipComments( char* p )
+{
+    p = XMLUtil::SkipWhiteSpace( p, 0 );
+    while ( p && XMLUtil::StringEqual( p, "<!--", 4 ) ) {
+        p = strstr( p + 4, "-->" );
+        if ( p ) {
+            p = XMLUtil::SkipWhiteSpace( p + 3, 0 );
+        }
+    }
+    return p;
+}
+
+
+// The '>' that ends the tag whose attributes start at p, or null.
+static char* FindTagEnd( char* p )
+{
+    while ( *p && *p != '>' ) {
+        if ( *p == '\"' || *p == '\'' ) {
+            p = strchr( p + 1, *p );
+            if ( !p ) {
+                return 0;
+            }
+        }
+        ++p;
+    }
+    return *p ? p : 0;
+}
+
+
+// Parses the document at p by splitting the content of its root element before
+// children that have the name of the first one, parsing the parts on threads into
+// the _partitions documents and moving their nodes under the root. Returns false,
+// having changed nothing, when the document should be parsed on this thread.
+bool XMLDocument::ParseParallel( char* p )
+{
+#ifdef TIXML_USE_THREADS
+    if ( _parseThreads < 2 || _internNames || _whitespaceMode == PEDANTIC_WHITESPACE ) {
+        return false;
+    }
+    // The root start tag, after declarations, comments and the doctype.
+    char* q = p;
+    while ( q && q[0] == '<' && ( q[1] == '?' || q[1] == '!' ) ) {
+        if ( q[1] == '?' ) {
+            q = strstr( q, "?>" );
+            q = q ? q + 2 : 0;
+        }
+        else if ( XMLUtil::StringEqual( q, "<!--", 4 ) ) {
+            q = strstr( q, "-->" );
+            q = q ? q + 3 : 0;
+        }
+        else {
+            q = strchr( q, '>' );
+            q = q ? q + 1 : 0;
+        }
+        q = q ? SkipComments( q ) : 0;
+    }
+    if ( !q || *q != '<' ) {
+        return false;
+    }
+    char* const rootName = q + 1;
+    const size_t rootNameLength = static_cast<size_t>( SkipName( rootName ) - rootName );
+    char* const rootEnd = rootNameLength ? FindTagEnd( rootName + rootNameLength ) : 0;
+    if ( !rootEnd || rootEnd[-1] == '/' ) {
+        return false;
+    }
+    char* const bodyStart = rootEnd + 1;
+
+    // Nothing but whitespace may follow the root end tag.
+    char* const end = bodyStart + strlen( bodyStart );
+    char* e = end;
+    while ( e > bodyStart && XMLUtil::IsWhiteSpace( e[-1] ) ) {
+        --e;
+    }
+    if ( e == bodyStart || e[-1] != '>' ) {
+        return false;
+    }
+    --e;
+    while ( e > bodyStart && XMLUtil::IsWhiteSpace( e[-1] ) ) {
+        --e;
+    }
+    if ( static_cast<size_t>( e - bodyStart ) < rootNameLength + 2 ) {
+        return false;
+    }
+    char* const bodyEnd = e - rootNameLength - 2;
+    if ( !XMLUtil::StringEqual( bodyEnd, "</", 2 ) || !XMLUtil::StringEqual( bodyEnd + 2, rootName, static_cast<int>( rootNameLength ) ) ) {
+        return false;
+    }
+
+    // The first child, and the name of the first child element.
+    char* const first = XMLUtil::SkipWhiteSpace( bodyStart, 0 );
+    char* const child = SkipComments( first );
+    if ( first >= bodyEnd || *first != '<' || !child || child >= bodyEnd || *child != '<' ) {
+        return false;
+    }
+    const size_t childNameLength = static_cast<size_t>( SkipName( child + 1 ) - ( child + 1 ) );
+    if ( !childNameLength ) {
+        return false;
+    }
+    const size_t length = static_cast<size_t>( bodyEnd - first );
+    const size_t most = length / MIN_PARTITION_BYTES;
+    const int count = most < static_cast<size_t>( _parseThreads ) ? static_cast<int>( most ) : _parseThreads;
+    if ( count < 2 ) {
+        return false;
+    }
+
+    // A part starts at the first '<' in its share of the body that opens a child with that
+    // name after the end of a tag. The parts are checked by parsing them: one that starts
+    // deeper, or in a comment or section, leaves the part before it unterminated.
+    DynArray<const char*, 16> starts;
+    starts.Push( first );
+    for ( int i = 1; i < count; ++i ) {
+        const char* const limit = first + length / count * ( i + 1 );
+        const char* s = first + length / count * i;
+        while ( s < limit && ( s = static_cast<const char*>( memchr( s, '<', static_cast<size_t>( limit - s ) ) ) ) != 0 ) {
+            if ( XMLUtil::StringEqual( s + 1, child + 1, static_cast<int>( childNameLength ) )
+                 && !XMLUtil::IsNameChar( static_cast<unsigned char>( s[1 + childNameLength] ) ) ) {
+                const char* before = s;
+                while ( XMLUtil::IsWhiteSpace( before[-1] ) ) {
+                    --before;
+                }
+                if ( before[-1] == '>' ) {
+                    starts.Push( s );
+                    break;
+                }
+            }
+            ++s;
+        }
+    }
+    const int parts = starts.Size();
+    if ( parts < 2 ) {
+        return false;
+    }
+    starts.Push( bodyEnd );
+    while ( _partitions.Size() < parts ) {
+        XMLDocument* partition = new XMLDocument( _processEntities, _whitespaceMode );
+        partition->SetRetainMemory( _retainMemory );
+        _partitions.Push( partition );
+    }
+
+    // Line numbers: each part counts its lines, then is parsed from the line it starts on.
+    DynArray<int, 16> lines;
+    lines.PushArr( parts + 1 );
+    RunOnThreads( parts, [&]( int i ) {
+        lines[i+1] = CountLines( starts[i], starts[i+1] );
+    } );
+    lines[0] = _parseCurLineNum + CountLines( p, first );
+    for ( int i = 1; i < parts; ++i ) {
+        lines[i] += lines[i-1];
+    }
+    RunOnThreads( parts, [&]( int i ) {
+        _partitions[i]->ParsePartition( starts[i], static_cast<size_t>( starts[i+1] - starts[i] ), lines[i] );
+    } );
+    bool parsed = true;
+    for ( int i = 0; i < parts; ++i ) {
+        parsed = parsed && !_partitions[i]->Error();
+    }
+    if ( !parsed ) {
+        for ( int i = 0; i < parts; ++i ) {
+            _partitions[i]->Clear();
+        }
+        return false;
+    }
+
+    // The parts are parsed from their own copies, so the body can go: the rest is parsed as
+    // the root element without content.
+    memmove( bodyStart, bodyEnd, static_cast<size_t>( end - bodyEnd ) + 1 );
+    ParseDeep( p, 0, &_parseCurLineNum );
+    if ( Error() ) {
+        for ( int i = 0; i < parts; ++i ) {
+            _partitions[i]->Clear();
+        }
+        return true;
+    }
+    XMLElement* const root = LastChild()->ToElement();
+    TIXMLASSERT( root && root->NoChildren() );
+
+    RunOnThreads( parts, [&]( int i ) {
+        _partitions[i]->MovePartition( this, root );
+    } );
+    for ( int i = 0; i < parts; ++i ) {
+        XMLDocument* const partition = _partitions[i];
+        if ( !partition->_firstChild ) {
+            continue;
+        }
+        if ( root->_lastChild ) {
+            root->_lastChild->_next = partition->_firstChild;
+            partition->_firstChild->_prev = root->_lastChild;
+        }
+        else {
+            root->_firstChild = partition->_firstChild;
+        }
+        root->_lastChild = partition->_lastChild;
+        partition->_firstChild = partition->_lastChild = 0;
+    }
+    return true;
+#else
+    (void)p;
+    return false;
+#endif
+}
+
+
+// Parses part of the content of another document's root element, at the depth and
+// from the line it has there.
+void XMLDocument::ParsePartition( const char* start, size_t bytes, int lineNum )
+{
+    Clear();
+    AllocateBuffer( bytes );
+    memcpy( _charBuffer, start, bytes );
+    _charBuffer[bytes] = 0;
+    _parsingDepth = 1;
+    _parseCurLineNum = lineNum;
+    _parseLineNum = lineNum;
+    // The document level only returns input when it read an end tag, which would have
+    // closed the root early in the serial parse.
+    if ( ParseDeep( _charBuffer, 0, &_parseCurLineNum ) && !Error() ) {
+        SetError( XML_ERROR_MISMATCHED_ELEMENT, _parseCurLineNum, 0 );
+    }
+    // Declarations are only allowed before the root.
+    for ( const XMLNode* node = FirstChild(); node && !Error(); node = node->NextSibling() ) {
+        if ( node->ToDeclaration() ) {
+            SetError( XML_ERROR_PARSING_DECLARATION, node->GetLineNum(), 0 );
+        }
+    }
+}
+
+
+// Makes the nodes of this partition belong to document and parent. They stay linked
+// to this document, which the caller unlinks.
+void XMLDocument::MovePartition( XMLDocument* document, XMLElement* parent )
+{
+    for ( XMLNode* top = _firstChild; top; top = top->_next ) {
+        XMLNode* node = top;
+        for ( ;; ) {
+            node->_document = document;
+            if ( node->_firstChild ) {
+                node = node->_firstChild;
+                continue;
+            }
+            while ( node != top && !node->_next ) {
+                node = node->_parent;
+            }
+            if ( node == top ) {
+                break;
+            }
+            node = node->_next;
+        }
+        top->_parent = parent;
+    }
+}
+
 void XMLDocument::PushDepth()
 {
 	_parsingDepth++;
@@ -2589,6 +3981,442 @@ void XMLDocument::PopDepth()
 	--_parsingDepth;
 }
 
+static int TagNameLength( const char* p )
+{
+    int n = 0;
+    while ( !XMLUtil::IsWhiteSpace( p[n] ) && p[n] != '/' && p[n] != '>' ) {
+        ++n;
+    }
+    return n;
+}
+
+
+XMLPushParser::XMLPushParser( XMLVisitor* visitor, int recordDepth, bool processEntities, Whitespace whitespaceMode ) :
+    _visitor( visitor ),
+    _recordDepth( recordDepth ),
+    _doc( processEntities, whitespaceMode ),
+    _openDoc( processEntities, whitespaceMode )
+{
+    TIXMLASSERT( _visitor );
+    TIXMLASSERT( _recordDepth >= 0 );
+    _doc.SetRetainMemory( true );
+    Reset();
+}
+
+
+void XMLPushParser::Reset()
+{
+    _doc.Clear();
+    _openDoc.Clear();
+    _openElement = 0;
+    _buffer.Clear();
+    _open.Clear();
+    _openStarts.Clear();
+    _close.Clear();
+    _depth = 0;
+    _scan = 0;
+    _line = 1;
+    _markup = TEXT;
+    _markupStart = 0;
+    _markupLine = 1;
+    _quote = 0;
+    _recordStart = 0;
+    _recordLine = 1;
+    _recordEnd = 0;
+    _recordEndLine = 1;
+    _skipLevel = -1;
+    _started = false;
+    _content = false;
+    _hasContent = false;
+}
+
+
+XMLError XMLPushParser::Feed( const char* data, size_t size )
+{
+    if ( Error() ) {
+        return ErrorID();
+    }
+    if ( !_started ) {
+        _started = true;
+        if ( !_visitor->VisitEnter( _doc ) ) {
+            _skipLevel = 0;
+        }
+    }
+    // Taken a slice at a time, so a large block does not grow the buffer to its size.
+    static const size_t SLICE = 64*1024;
+    while ( size && !Error() ) {
+        const size_t n = size < SLICE ? size : SLICE;
+        memcpy( _buffer.PushArr( static_cast<int>( n ) ), data, n );
+        data += n;
+        size -= n;
+
+        Scan();
+        if ( !Error() ) {
+            Dispatch( _recordEnd, _recordEndLine );
+        }
+        if ( _recordStart > 0 ) {
+            const int done = _recordStart;
+            memmove( _buffer.Mem(), _buffer.Mem() + done, _buffer.Size() - done );
+            _buffer.PopArr( done );
+            _scan -= done;
+            _markupStart -= done;
+            _recordStart = 0;
+            _recordEnd -= done;
+        }
+    }
+    return ErrorID();
+}
+
+
+XMLError XMLPushParser::Finish()
+{
+    if ( Error() ) {
+        return ErrorID();
+    }
+    if ( _markup != TEXT || _depth > 0 ) {
+        _doc.SetError( XML_ERROR_PARSING, _line, "Unexpected end of input" );
+        return ErrorID();
+    }
+    Dispatch( _buffer.Size(), _line );
+    if ( !Error() && !_content ) {
+        _doc.SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
+    }
+    if ( Error() ) {
+        return ErrorID();
+    }
+    _doc.Clear();
+    _visitor->VisitExit( _doc );
+    return XML_SUCCESS;
+}
+
+
+// Follows the markup in the buffer up to its end, where the nodes are told apart.
+void XMLPushParser::Scan()
+{
+    const char* buf = _buffer.Mem();
+    const int size = _buffer.Size();
+    while ( _scan < size && !Error() ) {
+        switch ( _markup ) {
+            case TEXT:
+            {
+                const char* lt = static_cast<const char*>( memchr( buf + _scan, '<', size - _scan ) );
+                const int end = lt ? static_cast<int>( lt - buf ) : size;
+                for ( ; _scan < end; ++_scan ) {
+                    if ( buf[_scan] == '\n' ) {
+                        ++_line;
+                    }
+                }
+                if ( lt ) {
+                    _markup = TAG;
+                    _markupStart = end;
+                    _markupLine = _line;
+                }
+                break;
+            }
+            case TAG:
+                if ( !Identify() ) {
+                    return;
+                }
+                break;
+            case START_TAG:
+            case END_TAG:
+            case DIRECTIVE:
+                for ( ; _scan < size; ++_scan ) {
+                    const char c = buf[_scan];
+                    if ( c == '\n' ) {
+                        ++_line;
+                    }
+                    if ( _quote ) {
+                        if ( c == _quote ) {
+                            _quote = 0;
+                        }
+                    }
+                    else if ( ( c == '"' || c == '\'' ) && _markup == START_TAG ) {
+                        _quote = c;
+                    }
+                    else if ( c == '>' ) {
+                        EndMarkup( ++_scan );
+                        break;
+                    }
+                }
+                break;
+            case COMMENT:
+                FindEnd( "-->" );
+                break;
+            case CDATA:
+                FindEnd( "]]>" );
+                break;
+            case PROCESSING:
+                FindEnd( "?>" );
+                break;
+        }
+    }
+}
+
+
+// Tells the kind of markup at _markupStart; false until enough of it is there.
+bool XMLPushParser::Identify()
+{
+    static const char* const commentHeader = "<!--";
+    static const char* const cdataHeader = "<![CDATA[";
+    const char* p = _buffer.Mem() + _markupStart;
+    const int available = _buffer.Size() - _markupStart;
+    if ( available < 2 ) {
+        return false;
+    }
+    _content = true;
+    _quote = 0;
+    if ( p[1] == '/' ) {
+        _markup = END_TAG;
+        _scan = _markupStart + 2;
+    }
+    else if ( p[1] == '?' ) {
+        _markup = PROCESSING;
+        _scan = _markupStart + 2;
+    }
+    else if ( p[1] == '!' ) {
+        const char* const headers[] = { commentHeader, cdataHeader };
+        const Markup kinds[] = { COMMENT, CDATA };
+        _markup = DIRECTIVE;
+        _scan = _markupStart + 2;
+        for ( int i = 0; i < 2; ++i ) {
+            const int length = static_cast<int>( strlen( headers[i] ) );
+            if ( memcmp( p, headers[i], available < length ? available : length ) == 0 ) {
+                if ( available < length ) {
+                    _markup = TAG;
+                    return false;
+                }
+                _markup = kinds[i];
+                _scan = _markupStart + length;
+                break;
+            }
+        }
+    }
+    else {
+        _markup = START_TAG;
+        _scan = _markupStart + 1;
+    }
+    return true;
+}
+
+
+// Looks for the terminator of a comment, CDATA section or declaration.
+bool XMLPushParser::FindEnd( const char* terminator )
+{
+    const int length = static_cast<int>( strlen( terminator ) );
+    const int content = _markupStart + ( _markup == COMMENT ? 4 : _markup == CDATA ? 9 : 2 );
+    const char* buf = _buffer.Mem();
+    const int size = _buffer.Size();
+    for ( ; _scan < size; ++_scan ) {
+        if ( buf[_scan] == '\n' ) {
+            ++_line;
+        }
+        const int start = _scan - length + 1;
+        if ( start >= content && memcmp( buf + start, terminator, length ) == 0 ) {
+            EndMarkup( ++_scan );
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void XMLPushParser::EndMarkup( int end )
+{
+    const Markup markup = _markup;
+    _markup = TEXT;
+    const char* buf = _buffer.Mem();
+    if ( markup == START_TAG ) {
+        const bool empty = buf[end-2] == '/';
+        if ( _depth < _recordDepth ) {
+            Dispatch( _markupStart, _markupLine );
+            if ( !Error() ) {
+                Open( _markupStart, end, empty );
+            }
+            if ( !Error() && empty ) {
+                Close();
+            }
+            else if ( !empty ) {
+                ++_depth;
+            }
+            _recordStart = _recordEnd = end;
+            _recordLine = _recordEndLine = _line;
+            return;
+        }
+        if ( !empty ) {
+            ++_depth;
+            return;
+        }
+    }
+    else if ( markup == END_TAG ) {
+        if ( _depth == 0 ) {
+            _doc.SetError( XML_ERROR_MISMATCHED_ELEMENT, _markupLine, 0 );
+            return;
+        }
+        if ( --_depth < _recordDepth ) {
+            const char* name = _open.Mem() + _openStarts.PeekTop() + 1;
+            const int length = TagNameLength( name );
+            if ( TagNameLength( buf + _markupStart + 2 ) != length || memcmp( name, buf + _markupStart + 2, length ) != 0 ) {
+                _doc.SetError( XML_ERROR_MISMATCHED_ELEMENT, _markupLine, 0 );
+                return;
+            }
+            Dispatch( _markupStart, _markupLine, true );
+            if ( !Error() ) {
+                Close();
+            }
+            _recordStart = _recordEnd = end;
+            _recordLine = _recordEndLine = _line;
+            return;
+        }
+    }
+    if ( _depth <= _recordDepth ) {
+        _recordEnd = end;
+        _recordEndLine = _line;
+    }
+}
+
+
+// Parses the pending nodes up to end and hands them to the visitor; closing
+// when they are followed by the end tag of the innermost open element.
+void XMLPushParser::Dispatch( int end, int endLine, bool closing )
+{
+    TIXMLASSERT( end >= _recordStart );
+    const char* p = _buffer.Mem() + _recordStart;
+    int length = end - _recordStart;
+    int lineNum = _recordLine;
+    _recordStart = end;
+    _recordLine = endLine;
+
+    const int level = _openStarts.Size();
+    const bool first = !_hasContent;
+    if ( length == 0 || Skipping( level ) ) {
+        return;
+    }
+    _hasContent = true;
+    if ( level == 0 && lineNum == 1 && length >= 3
+         && static_cast<unsigned char>( p[0] ) == TIXML_UTF_LEAD_0
+         && static_cast<unsigned char>( p[1] ) == TIXML_UTF_LEAD_1
+         && static_cast<unsigned char>( p[2] ) == TIXML_UTF_LEAD_2 ) {
+        p += 3;
+        length -= 3;
+    }
+    // Whitespace between nodes is not kept; pedantic whitespace is when it is all
+    // there is in an element.
+    if ( level == 0 || !first || !closing || _doc.WhitespaceMode() != PEDANTIC_WHITESPACE ) {
+        int i = 0;
+        while ( i < length && XMLUtil::IsWhiteSpace( p[i] ) ) {
+            ++i;
+        }
+        if ( i == length ) {
+            return;
+        }
+    }
+    for ( int i = 0; i < _open.Size(); ++i ) {
+        if ( _open[i] == '\n' ) {
+            --lineNum;
+        }
+    }
+    if ( _doc.ParseParts( _open.Mem(), _open.Size(), p, length, _close.Mem(), _close.Size(), lineNum ) != XML_SUCCESS ) {
+        return;
+    }
+    const XMLNode* parent = &_doc;
+    for ( int i = 0; i < level; ++i ) {
+        parent = parent->FirstChildElement();
+        TIXMLASSERT( parent );
+    }
+    for ( const XMLNode* node = parent->FirstChild(); node; node = node->NextSibling() ) {
+        if ( !node->Accept( _visitor ) ) {
+            _skipLevel = level;
+            break;
+        }
+    }
+}
+
+
+// Enters the element whose start tag is at start.
+void XMLPushParser::Open( int start, int end, bool empty )
+{
+    const int level = _openStarts.Size();
+    _openStarts.Push( _open.Size() );
+    const int length = end - start - ( empty ? 2 : 1 );
+    memcpy( _open.PushArr( length ), _buffer.Mem() + start, length );
+    _open.Push( '>' );
+    EndTags();
+
+    if ( !Skipping( level ) ) {
+        const XMLElement* element = ParseOpen( _markupLine );
+        if ( !element ) {
+            return;
+        }
+        XMLElement* copy = element->ShallowClone( &_openDoc )->ToElement();
+        copy->_parseLineNum = element->_parseLineNum;
+        ( _openElement ? static_cast<XMLNode*>( _openElement ) : &_openDoc )->InsertEndChild( copy );
+        _openElement = copy;
+        if ( !_visitor->VisitEnter( *copy, copy->FirstAttribute() ) ) {
+            _skipLevel = level + 1;
+        }
+    }
+    _hasContent = false;
+}
+
+
+// Leaves the innermost open element.
+void XMLPushParser::Close()
+{
+    const int level = _openStarts.Size() - 1;
+    if ( !Skipping( level ) ) {
+        TIXMLASSERT( _openElement );
+        if ( !_visitor->VisitExit( *_openElement ) ) {
+            _skipLevel = level;
+        }
+        XMLNode* parent = _openElement->Parent();
+        _openDoc.DeleteNode( _openElement );
+        _openElement = parent->ToElement();
+    }
+    _open.PopArr( _open.Size() - _openStarts.Pop() );
+    EndTags();
+    if ( _skipLevel == level + 1 ) {
+        _skipLevel = -1;
+    }
+    _hasContent = true;
+}
+
+
+void XMLPushParser::EndTags()
+{
+    _close.Clear();
+    for ( int i = _openStarts.Size() - 1; i >= 0; --i ) {
+        const char* name = _open.Mem() + _openStarts[i] + 1;
+        const int length = TagNameLength( name );
+        _close.Push( '<' );
+        _close.Push( '/' );
+        memcpy( _close.PushArr( length ), name, length );
+        _close.Push( '>' );
+    }
+}
+
+
+// Parses the open elements alone; returns the innermost one, which starts on lineNum.
+XMLElement* XMLPushParser::ParseOpen( int lineNum )
+{
+    const int innermost = _openStarts.PeekTop();
+    for ( int i = 0; i < innermost; ++i ) {
+        if ( _open[i] == '\n' ) {
+            --lineNum;
+        }
+    }
+    if ( _doc.ParseParts( _open.Mem(), _open.Size(), 0, 0, _close.Mem(), _close.Size(), lineNum ) != XML_SUCCESS ) {
+        return 0;
+    }
+    XMLElement* element = _doc.FirstChildElement();
+    for ( int i = 1; i < _openStarts.Size(); ++i ) {
+        TIXMLASSERT( element );
+        element = element->FirstChildElement();
+    }
+    return element;
+}
+
+
 XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
     _elementJustOpened( false ),
     _stack(),
@@ -2598,7 +4426,10 @@ XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
     _textDepth( -1 ),
     _processEntities( true ),
     _compactMode( compact ),
-    _buffer()
+    _buffer(),
+    _sink( 0 ),
+    _sinkBuffer( 0 ),
+    _sinkUsed( 0 )
 {
     for( int i=0; i<ENTITY_RANGE; ++i ) {
         _entityFlag[i] = false;
@@ -2617,6 +4448,31 @@ XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
 }
 
 
+XMLPrinter::XMLPrinter( XMLSink& sink, bool compact, int depth ) :
+    XMLPrinter( static_cast<FILE*>( 0 ), compact, depth )
+{
+    _sink = &sink;
+    _sinkBuffer = new char[SINK_BUFFER_SIZE];
+}
+
+
+XMLPrinter::~XMLPrinter()
+{
+    Flush();
+    delete [] _sinkBuffer;
+}
+
+
+void XMLPrinter::Flush()
+{
+    if ( _sink && _sinkUsed ) {
+        const size_t used = _sinkUsed;
+        _sinkUsed = 0;
+        _sink->Write( _sinkBuffer, used );
+    }
+}
+
+
 void XMLPrinter::Print( const char* format, ... )
 {
     va_list     va;
@@ -2625,6 +4481,25 @@ void XMLPrinter::Print( const char* format, ... )
     if ( _fp ) {
         vfprintf( _fp, format, va );
     }
+    else if ( _sink ) {
+        const int len = TIXML_VSCPRINTF( format, va );
+        va_end( va );
+        TIXMLASSERT( len >= 0 );
+        va_start( va, format );
+        if ( _sinkUsed + len + 1 > SINK_BUFFER_SIZE ) {
+            Flush();
+        }
+        if ( len + 1 <= SINK_BUFFER_SIZE ) {
+            TIXML_VSNPRINTF( _sinkBuffer + _sinkUsed, len+1, format, va );
+            _sinkUsed += len;
+        }
+        else {
+            char* text = new char[len+1];
+            TIXML_VSNPRINTF( text, len+1, format, va );
+            _sink->Write( text, len );
+            delete [] text;
+        }
+    }
     else {
         const int len = TIXML_VSCPRINTF( format, va );
         // Close out and re-start the va-args
@@ -2641,7 +4516,18 @@ void XMLPrinter::Print( const char* format, ... )
 
 void XMLPrinter::Write( const char* data, size_t size )
 {
-    if ( _fp ) {
+    if ( _sink ) {
+        if ( _sinkUsed + size > SINK_BUFFER_SIZE ) {
+            Flush();
+            if ( size >= SINK_BUFFER_SIZE ) {
+                _sink->Write( data, size );
+                return;
+            }
+        }
+        memcpy( _sinkBuffer + _sinkUsed, data, size );
+        _sinkUsed += size;
+    }
+    else if ( _fp ) {
         fwrite ( data , sizeof(char), size, _fp);
     }
     else {
@@ -2654,7 +4540,13 @@ void XMLPrinter::Write( const char* data, size_t size )
 
 void XMLPrinter::Putc( char ch )
 {
-    if ( _fp ) {
+    if ( _sink ) {
+        if ( _sinkUsed == SINK_BUFFER_SIZE ) {
+            Flush();
+        }
+        _sinkBuffer[_sinkUsed++] = ch;
+    }
+    else if ( _fp ) {
         fputc ( ch, _fp);
     }
     else {
@@ -2781,11 +4673,23 @@ void XMLPrinter::PushAttribute( const char* name, const char* value )
 }
 
 
+// Formatted numbers never hold characters that need escaping.
+void XMLPrinter::PushNumberAttribute( const char* name, const char* value )
+{
+    TIXMLASSERT( _elementJustOpened );
+    Putc ( ' ' );
+    Write( name );
+    Write( "=\"" );
+    Write( value );
+    Putc ( '\"' );
+}
+
+
 void XMLPrinter::PushAttribute( const char* name, int v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    PushAttribute( name, buf );
+    PushNumberAttribute( name, buf );
 }
 
 
@@ -2793,7 +4697,7 @@ void XMLPrinter::PushAttribute( const char* name, unsigned v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    PushAttribute( name, buf );
+    PushNumberAttribute( name, buf );
 }
 
 
@@ -2801,7 +4705,7 @@ void XMLPrinter::PushAttribute(const char* name, int64_t v)
 {
 	char buf[BUF_SIZE];
 	XMLUtil::ToStr(v, buf, BUF_SIZE);
-	PushAttribute(name, buf);
+	PushNumberAttribute(name, buf);
 }
 
 
@@ -2809,7 +4713,7 @@ void XMLPrinter::PushAttribute(const char* name, uint64_t v)
 {
 	char buf[BUF_SIZE];
 	XMLUtil::ToStr(v, buf, BUF_SIZE);
-	PushAttribute(name, buf);
+	PushNumberAttribute(name, buf);
 }
 
 
@@ -2825,7 +4729,7 @@ void XMLPrinter::PushAttribute( const char* name, double v )
 {
     char buf[BUF_SIZE];
     XMLUtil::ToStr( v, buf, BUF_SIZE );
-    PushAttribute( name, buf );
+    PushNumberAttribute( name, buf );
 }
 
 
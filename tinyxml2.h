@@ -121,6 +121,9 @@ class XMLText;
 class XMLDeclaration;
 class XMLUnknown;
 class XMLPrinter;
+class NameTable;
+class XMLPushParser;
+class XMLSaxHandler;
 
 /*
 	A class that wraps strings. Normally stores the start and end
@@ -170,6 +173,8 @@ public:
     }
 
     void SetStr( const char* str, int flags=0 );
+    // Replaces a name just read by ParseName() with its copy in table.
+    void InternName( NameTable* table );
 
     char* ParseText( char* in, const char* endTag, int strFlags, int* curLineNumPtr );
     char* ParseName( char* in );
@@ -320,6 +325,56 @@ private:
 };
 
 
+/*
+	A set of names, each stored once, so that two names from the same table are
+	equal exactly when their pointers are. Used by documents that intern element
+	and attribute names.
+*/
+class TINYXML2_LIB NameTable
+{
+public:
+    NameTable() : _slots( 0 ), _capacity( 0 ), _count( 0 ) {}
+    ~NameTable();
+
+    // The stored copy of name, added if it is not in the table yet.
+    const char* Intern( const char* name, size_t length );
+    // The stored copy of name, or null if it is not in the table.
+    const char* Find( const char* name, size_t length ) const;
+    int Size() const { return static_cast<int>( _count ); }
+
+private:
+    NameTable( const NameTable& );	// not supported
+    void operator=( const NameTable& );	// not supported
+
+    size_t Slot( const char* name, size_t length ) const;
+    void Grow();
+
+    char** _slots;
+    size_t _capacity;
+    size_t _count;
+};
+
+
+/**
+	A name interned in a document with XMLDocument::Intern(). Element and attribute
+	lookups by handle compare pointers instead of strings when the document was
+	created with internNames. A handle is only meaningful for the document that
+	returned it.
+*/
+class TINYXML2_LIB XMLName
+{
+    friend class XMLDocument;
+public:
+    XMLName() : _name( 0 ) {}
+    const char* Str() const { return _name; }
+    bool Empty() const { return _name == 0; }
+
+private:
+    explicit XMLName( const char* name ) : _name( name ) {}
+    const char* _name;
+};
+
+
 /*
 	Parent virtual class of a pool for fast allocation
 	and deallocation of objects.
@@ -344,24 +399,52 @@ template< int ITEM_SIZE >
 class MemPoolT : public MemPool
 {
 public:
-    MemPoolT() : _blockPtrs(), _root(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
+    MemPoolT() : _blocks(), _root(0), _itemsPerBlock(ITEMS_PER_BLOCK), _capacity(0), _currentAllocs(0), _nAllocs(0), _maxAllocs(0), _nUntracked(0)	{}
     ~MemPoolT() {
         MemPoolT< ITEM_SIZE >::Clear();
     }
 
     void Clear() {
         // Delete the blocks.
-        while( !_blockPtrs.Empty()) {
-            Block* lastBlock = _blockPtrs.Pop();
-            delete lastBlock;
+        while( !_blocks.Empty()) {
+            Block lastBlock = _blocks.Pop();
+            delete [] lastBlock.items;
         }
         _root = 0;
+        _capacity = 0;
+        _currentAllocs = 0;
+        _nAllocs = 0;
+        _maxAllocs = 0;
+        _nUntracked = 0;
+    }
+
+    // Marks every item free but keeps the blocks. Only valid when no item is in use any more.
+    void Reset() {
+        _root = 0;
+        for( int i = _blocks.Size() - 1; i >= 0; --i ) {
+            LinkBlock( _blocks[i] );
+        }
         _currentAllocs = 0;
         _nAllocs = 0;
         _maxAllocs = 0;
         _nUntracked = 0;
     }
 
+    // Size in bytes of the blocks allocated from now on; at least one item.
+    void SetBlockSize( int bytes ) {
+        _itemsPerBlock = bytes / ITEM_SIZE > 0 ? bytes / ITEM_SIZE : 1;
+    }
+
+    // Allocates blocks until count items fit without another allocation.
+    void Reserve( int count ) {
+        while ( _capacity - _currentAllocs < count ) {
+            AddBlock();
+        }
+    }
+    int Capacity() const {
+        return _capacity;
+    }
+
     virtual int ItemSize() const override{
         return ITEM_SIZE;
     }
@@ -372,15 +455,7 @@ public:
     virtual void* Alloc() override{
         if ( !_root ) {
             // Need a new block.
-            Block* block = new Block;
-            _blockPtrs.Push( block );
-
-            Item* blockItems = block->items;
-            for( int i = 0; i < ITEMS_PER_BLOCK - 1; ++i ) {
-                blockItems[i].next = &(blockItems[i + 1]);
-            }
-            blockItems[ITEMS_PER_BLOCK - 1].next = 0;
-            _root = blockItems;
+            AddBlock();
         }
         Item* const result = _root;
         TIXMLASSERT( result != 0 );
@@ -410,7 +485,7 @@ public:
     void Trace( const char* name ) {
         printf( "Mempool %s watermark=%d [%dk] current=%d size=%d nAlloc=%d blocks=%d\n",
                 name, _maxAllocs, _maxAllocs * ITEM_SIZE / 1024, _currentAllocs,
-                ITEM_SIZE, _nAllocs, _blockPtrs.Size() );
+                ITEM_SIZE, _nAllocs, _blocks.Size() );
     }
 
     void SetTracked() override {
@@ -432,6 +507,7 @@ public:
 	//		64k:	4000	21000
     // Declared public because some compilers do not accept to use ITEMS_PER_BLOCK
     // in private part if ITEMS_PER_BLOCK is private
+    // This is the default; SetBlockSize() changes it for one pool.
     enum { ITEMS_PER_BLOCK = (4 * 1024) / ITEM_SIZE };
 
 private:
@@ -443,10 +519,31 @@ private:
         char    itemData[static_cast<size_t>(ITEM_SIZE)];
     };
     struct Block {
-        Item items[ITEMS_PER_BLOCK];
+        Item* items;
+        int count;
     };
-    DynArray< Block*, 10 > _blockPtrs;
+
+    // Puts the items of block on the free list, in address order.
+    void LinkBlock( const Block& block ) {
+        for( int i = 0; i < block.count - 1; ++i ) {
+            block.items[i].next = &(block.items[i + 1]);
+        }
+        block.items[block.count - 1].next = _root;
+        _root = block.items;
+    }
+    void AddBlock() {
+        Block block;
+        block.items = new Item[_itemsPerBlock];
+        block.count = _itemsPerBlock;
+        _blocks.Push( block );
+        _capacity += block.count;
+        LinkBlock( block );
+    }
+
+    DynArray< Block, 10 > _blocks;
     Item* _root;
+    int _itemsPerBlock;
+    int _capacity;
 
     int _currentAllocs;
     int _nAllocs;
@@ -551,18 +648,26 @@ public:
     static const char* SkipWhiteSpace( const char* p, int* curLineNumPtr )	{
         TIXMLASSERT( p );
 
-        while( IsWhiteSpace(*p) ) {
-            if (curLineNumPtr && *p == '\n') {
-                ++(*curLineNumPtr);
-            }
-            ++p;
+        // Most calls have nothing, or a single space, to skip.
+        if ( !IsWhiteSpace(*p) ) {
+            return p;
         }
+        if ( *p == ' ' && !IsWhiteSpace(*(p+1)) ) {
+            return p + 1;
+        }
+        p = SkipWhiteSpaceRun( p, curLineNumPtr );
         TIXMLASSERT( p );
         return p;
     }
     static char* SkipWhiteSpace( char* const p, int* curLineNumPtr ) {
         return const_cast<char*>( SkipWhiteSpace( const_cast<const char*>(p), curLineNumPtr ) );
     }
+    // Skips a run of whitespace and returns the first other character, counting the newlines
+    // passed if curLineNumPtr is set. Uses SSE2 or AVX2 when the CPU has it.
+    static const char* SkipWhiteSpaceRun( const char* p, int* curLineNumPtr );
+    // Returns the first endChar or null terminator at or after p and adds the newlines before
+    // it to *curLineNumPtr. Uses SSE2 or AVX2 when the CPU has it.
+    static const char* ScanText( const char* p, char endChar, int* curLineNumPtr );
 
     // Anything in the high order range of UTF-8 is assumed to not be whitespace. This isn't
     // correct, but simple, and usually works.
@@ -672,6 +777,7 @@ class TINYXML2_LIB XMLNode
 {
     friend class XMLDocument;
     friend class XMLElement;
+    friend class XMLPushParser;
 public:
 
     /// Get the XMLDocument that owns this XMLNode.
@@ -786,6 +892,13 @@ public:
         return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->FirstChildElement( name ));
     }
 
+    /// Get the first child element with an interned name.
+    const XMLElement* FirstChildElement( const XMLName& name ) const;
+
+    XMLElement* FirstChildElement( const XMLName& name )	{
+        return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->FirstChildElement( name ));
+    }
+
     /// Get the last child node, or null if none exists.
     const XMLNode*	LastChild() const						{
         return _lastChild;
@@ -804,6 +917,13 @@ public:
         return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->LastChildElement(name) );
     }
 
+    /// Get the last child element with an interned name.
+    const XMLElement* LastChildElement( const XMLName& name ) const;
+
+    XMLElement* LastChildElement( const XMLName& name )	{
+        return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->LastChildElement(name) );
+    }
+
     /// Get the previous (left) sibling node of this node.
     const XMLNode*	PreviousSibling() const					{
         return _prev;
@@ -820,6 +940,13 @@ public:
         return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->PreviousSiblingElement( name ) );
     }
 
+    /// Get the previous (left) sibling element with an interned name.
+    const XMLElement*	PreviousSiblingElement( const XMLName& name ) const;
+
+    XMLElement*	PreviousSiblingElement( const XMLName& name ) {
+        return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->PreviousSiblingElement( name ) );
+    }
+
     /// Get the next (right) sibling node of this node.
     const XMLNode*	NextSibling() const						{
         return _next;
@@ -836,6 +963,13 @@ public:
         return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->NextSiblingElement( name ) );
     }
 
+    /// Get the next (right) sibling element with an interned name.
+    const XMLElement*	NextSiblingElement( const XMLName& name ) const;
+
+    XMLElement*	NextSiblingElement( const XMLName& name )	{
+        return const_cast<XMLElement*>(const_cast<const XMLNode*>(this)->NextSiblingElement( name ) );
+    }
+
     /**
     	Add a child node as the last (right) child.
 		If the child node is already part of the document,
@@ -973,6 +1107,7 @@ private:
     static void DeleteNode( XMLNode* node );
     void InsertChildPreamble( XMLNode* insertThis ) const;
     const XMLElement* ToElementWithName( const char* name ) const;
+    const XMLElement* ToElementWithName( const XMLName& name ) const;
 
     XMLNode( const XMLNode& );	// not supported
     XMLNode& operator=( const XMLNode& );	// not supported
@@ -1519,6 +1654,8 @@ public:
     }
     /// Query a specific attribute in the list.
     const XMLAttribute* FindAttribute( const char* name ) const;
+    /// Query a specific attribute by interned name.
+    const XMLAttribute* FindAttribute( const XMLName& name ) const;
 
     /** Convenience function for easy access to the text inside an element. Although easy
     	and concise, GetText() is limited compared to getting the XMLText child
@@ -1712,6 +1849,76 @@ enum Whitespace {
 };
 
 
+/**
+	The attributes of an element read by a XMLSaxHandler. Names and values
+	point into the buffer of the document being parsed and are only valid
+	during the StartElement() call.
+*/
+class TINYXML2_LIB XMLSaxAttributes
+{
+    friend class XMLDocument;
+public:
+    int Count() const					{
+        return _count;
+    }
+    const char* Name( int i ) const		{
+        TIXMLASSERT( i >= 0 && i < _count );
+        return _pairs[2*i];
+    }
+    const char* Value( int i ) const	{
+        TIXMLASSERT( i >= 0 && i < _count );
+        return _pairs[2*i+1];
+    }
+
+    /// The value of the attribute, or null. See XMLElement::Attribute().
+    const char* Attribute( const char* name, const char* value=0 ) const;
+    /// The value of the attribute as an int, or defaultValue if there is none or it is not a number.
+    int IntAttribute( const char* name, int defaultValue = 0 ) const;
+    /// See IntAttribute()
+    unsigned UnsignedAttribute( const char* name, unsigned defaultValue = 0 ) const;
+    /// See IntAttribute()
+    int64_t Int64Attribute( const char* name, int64_t defaultValue = 0 ) const;
+    /// See IntAttribute()
+    bool BoolAttribute( const char* name, bool defaultValue = false ) const;
+    /// See IntAttribute()
+    double DoubleAttribute( const char* name, double defaultValue = 0 ) const;
+    /// See IntAttribute()
+    float FloatAttribute( const char* name, float defaultValue = 0 ) const;
+
+private:
+    XMLSaxAttributes( const char* const* pairs, int count ) : _pairs( pairs ), _count( count ) {}
+
+    const char* const*	_pairs;
+    int					_count;
+};
+
+
+/**
+	Receives a document as XMLDocument::Parse() or LoadFile() reads it, when
+	set with XMLDocument::SetSaxHandler(). No nodes are created: names,
+	attributes and text are passed straight from the buffer of the document.
+	Returning false from a callback stops the parse.
+*/
+class TINYXML2_LIB XMLSaxHandler
+{
+public:
+    virtual ~XMLSaxHandler() {}
+
+    /// An element starts. Empty elements are followed by EndElement() right away.
+    virtual bool StartElement( const char* /*name*/, const XMLSaxAttributes& /*attributes*/ )	{
+        return true;
+    }
+    /// An element ends.
+    virtual bool EndElement( const char* /*name*/ )			{
+        return true;
+    }
+    /// Text or a CDATA section.
+    virtual bool Text( const char* /*text*/, bool /*cdata*/ )	{
+        return true;
+    }
+};
+
+
 /** A Document binds together all the functionality.
 	It can be saved, loaded, and printed to the screen.
 	All Nodes are connected and allocated to a Document.
@@ -1727,9 +1934,13 @@ class TINYXML2_LIB XMLDocument : public XMLNode
     friend class XMLComment;
     friend class XMLDeclaration;
     friend class XMLUnknown;
+    friend class XMLPushParser;
 public:
-    /// constructor
-    XMLDocument( bool processEntities = true, Whitespace whitespaceMode = PRESERVE_WHITESPACE );
+    /** constructor
+        With internNames, element and attribute names are kept once in a name table
+        of the document, and lookups compare them by pointer.
+    */
+    XMLDocument( bool processEntities = true, Whitespace whitespaceMode = PRESERVE_WHITESPACE, bool internNames = false );
     ~XMLDocument();
 
     virtual XMLDocument* ToDocument() override		{
@@ -1768,6 +1979,10 @@ public:
         not text in order for TinyXML-2 to correctly
         do newline normalization.
 
+        Regular files are mapped into memory and parsed in
+        place where the platform allows it; pipes and other
+        streams are read into a buffer.
+
     	Returns XML_SUCCESS (0) on success, or
     	an errorID.
     */
@@ -1795,6 +2010,71 @@ public:
     Whitespace WhitespaceMode() const	{
         return _whitespaceMode;
     }
+    bool InternsNames() const			{
+        return _internNames;
+    }
+
+    /**
+        Returns the handle of a name in this document's name table, adding it if needed.
+        Intern the names a program looks up once and reuse the handles:
+
+        @verbatim
+        const XMLName classroom = doc.Intern( "classroom" );
+        for( XMLElement* e = root->FirstChildElement( classroom ); e; e = e->NextSiblingElement( classroom ) )
+        @endverbatim
+
+        Handles stay valid for the life of the document, across Clear() and reloads.
+    */
+    XMLName Intern( const char* name );
+
+    /**
+        With retainMemory, the memory of a document is kept for the next one: Clear(),
+        LoadFile() and Parse() reuse the node pools and the text buffer (a failed parse
+        included) and reserve pool space before parsing for as many nodes per byte as
+        the previous document had. Reloading similar documents then allocates nothing.
+        Off by default.
+    */
+    void SetRetainMemory( bool retainMemory );
+    bool RetainsMemory() const			{
+        return _retainMemory;
+    }
+    /// Size in bytes of the node pool blocks allocated from now on (4k by default).
+    void SetPoolBlockSize( int bytes );
+    /**
+        Reserves node pool space for a document of about documentBytes bytes, with the
+        nodes per byte of the last document loaded with retainMemory. Reserves nothing
+        before one was loaded.
+    */
+    void Reserve( size_t documentBytes );
+
+    /**
+        With a handler set, Parse() and LoadFile() report the document to it
+        as they read it instead of building nodes; the document stays empty.
+        Null, the default, builds the DOM.
+    */
+    void SetSaxHandler( XMLSaxHandler* handler )	{
+        _saxHandler = handler;
+    }
+    XMLSaxHandler* SaxHandler() const				{
+        return _saxHandler;
+    }
+
+    /**
+        With more than one thread, Parse() and LoadFile() split a large document
+        between the children of its root element, parse the parts on up to that many
+        threads into pools of their own and link the results under the root. Splits
+        are made before children named like the first one. When no split is found,
+        or a part does not parse on its own, the document is parsed on the calling
+        thread, so results and errors are the same either way. Documents that intern
+        names, have a SAX handler or use PEDANTIC_WHITESPACE always parse on the
+        calling thread. 1, the default, starts no threads.
+    */
+    void SetParseThreads( int threads )			{
+        _parseThreads = threads > 1 ? threads : 1;
+    }
+    int ParseThreads() const					{
+        return _parseThreads;
+    }
 
     /**
     	Returns true if this document has a leading Byte Order Mark of UTF8.
@@ -1939,9 +2219,24 @@ private:
     bool			_processEntities;
     XMLError		_errorID;
     Whitespace		_whitespaceMode;
+    bool			_internNames;
+    NameTable		_names;
     mutable StrPair	_errorStr;
     int             _errorLineNum;
     char*			_charBuffer;
+    size_t			_charBufferSize;
+    size_t			_charBufferMapSize;	// non-zero when _charBuffer is a file mapping
+    bool			_retainMemory;
+    char*			_retainedBuffer;	// text buffer of the previous document, kept with retainMemory
+    size_t			_retainedBufferSize;
+    size_t			_documentBytes;		// size of the loaded document, counted into the densities by Clear()
+    double			_elementDensity;	// nodes per byte of the last document, for Reserve()
+    double			_attributeDensity;
+    double			_textDensity;
+    double			_commentDensity;
+    XMLSaxHandler*	_saxHandler;
+    int				_parseThreads;
+    DynArray<XMLDocument*, 8> _partitions;	// documents that own the nodes of a parallel parse
     int				_parseCurLineNum;
 	int				_parsingDepth;
 	// Memory tracking does add some overhead.
@@ -1959,7 +2254,15 @@ private:
 
 	static const char* _errorNames[XML_ERROR_COUNT];
 
-    void Parse();
+    void Parse( int lineNum = 1 );
+    void ParseSax( char* p );
+    bool ParseParallel( char* p );
+    void ParsePartition( const char* start, size_t bytes, int lineNum );
+    void MovePartition( XMLDocument* document, XMLElement* parent );
+    XMLError ParseParts( const char* head, size_t headBytes, const char* body, size_t bodyBytes,
+                         const char* tail, size_t tailBytes, int lineNum );
+    bool MapFile( FILE* fp );
+    char* AllocateBuffer( size_t size );
 
     void SetError( XMLError error, int lineNum, const char* format, ... );
 
@@ -1998,6 +2301,102 @@ inline NodeType* XMLDocument::CreateUnlinkedNode( MemPoolT<PoolElementSize>& poo
     return returnNode;
 }
 
+/**
+	Parses a document that arrives in pieces, e.g. from a pipe or a socket,
+	without holding all of it. Input is handed to Feed() as it comes and
+	Finish() is called at its end.
+
+	The elements down to recordDepth (the root is at depth 0) are reported as
+	they open and close with XMLVisitor::VisitEnter() and VisitExit(). Each
+	node below them is parsed once it is complete and passed to the visitor
+	with Accept(); by default that is every child of the root. Only the
+	incomplete node is buffered, so the memory used is bounded by the largest
+	such node, not by the document. The nodes belong to the parser and are
+	only valid during the call; DeepClone() keeps a copy.
+
+	The visitor works as it does with XMLNode::Accept(): returning false from
+	VisitEnter() skips the children of an element, and returning false for a
+	node skips its remaining siblings.
+
+	@verbatim
+	XMLPushParser parser( &visitor );
+	while ( ( n = read( fd, buffer, sizeof( buffer ) ) ) > 0 && parser.Feed( buffer, n ) == XML_SUCCESS )
+		;
+	parser.Finish();
+	@endverbatim
+*/
+class TINYXML2_LIB XMLPushParser
+{
+public:
+    XMLPushParser( XMLVisitor* visitor, int recordDepth = 1, bool processEntities = true, Whitespace whitespaceMode = PRESERVE_WHITESPACE );
+
+    /// Parses the next size bytes of the document. Returns the error, if any, so far.
+    XMLError Feed( const char* data, size_t size );
+    /// Ends the document. Returns XML_SUCCESS if it was complete and well formed.
+    XMLError Finish();
+    /// Forgets the current document so the parser can be used for another one.
+    void Reset();
+
+    bool Error() const				{
+        return _doc.Error();
+    }
+    XMLError ErrorID() const		{
+        return _doc.ErrorID();
+    }
+    const char* ErrorStr() const	{
+        return _doc.ErrorStr();
+    }
+    /// The line of the document where the error occurred.
+    int ErrorLineNum() const		{
+        return _doc.ErrorLineNum();
+    }
+
+private:
+    XMLPushParser( const XMLPushParser& );	// not supported
+    void operator=( const XMLPushParser& );	// not supported
+
+    enum Markup { TEXT, TAG, START_TAG, END_TAG, COMMENT, CDATA, PROCESSING, DIRECTIVE };
+
+    void Scan();
+    bool Identify();
+    bool FindEnd( const char* terminator );
+    void EndMarkup( int end );
+    void Dispatch( int end, int endLine, bool closing = false );
+    void Open( int start, int end, bool empty );
+    void Close();
+    void EndTags();
+    XMLElement* ParseOpen( int lineNum );
+    bool Skipping( int level ) const	{
+        return _skipLevel >= 0 && level >= _skipLevel;
+    }
+
+    XMLVisitor*		_visitor;
+    int				_recordDepth;
+    XMLDocument		_doc;
+    XMLDocument		_openDoc;		// copies of the open elements, alive from VisitEnter() to VisitExit()
+    XMLElement*		_openElement;
+    DynArray<char, 1024> _buffer;	// input not handed to the visitor yet
+    DynArray<char, 256>	_open;		// start tags of the open elements above recordDepth
+    DynArray<int, 10>	_openStarts;
+    DynArray<char, 256>	_close;		// and their end tags, innermost first
+    int				_depth;
+    int				_scan;
+    int				_line;
+    Markup			_markup;
+    int				_markupStart;
+    int				_markupLine;
+    char			_quote;
+    int				_recordStart;	// the pending nodes, complete up to _recordEnd
+    int				_recordLine;
+    int				_recordEnd;
+    int				_recordEndLine;
+    int				_skipLevel;
+    bool			_started;
+    bool			_content;
+    bool			_hasContent;	// of the innermost open element, up to _recordStart
+};
+
+
 /**
 	A XMLHandle is a class that wraps a node pointer with null checks; this is
 	an incredibly useful thing. Note that XMLHandle is not part of the TinyXML-2
@@ -2196,6 +2595,31 @@ private:
 };
 
 
+/**
+	Where a XMLPrinter constructed with one sends its output: a file
+	descriptor, a socket, a string owned by the caller.
+
+	Write() may report a failure by throwing. The printer's destructor
+	flushes the rest of the output, and an exception thrown there ends the
+	program, so with a sink that can fail call XMLPrinter::Flush() before
+	the printer is destroyed.
+
+	@verbatim
+	struct StringSink : XMLSink {
+		std::string* out;
+		virtual void Write( const char* data, size_t size ) { out->append( data, size ); }
+	};
+	@endverbatim
+*/
+class TINYXML2_LIB XMLSink
+{
+public:
+    virtual ~XMLSink() {}
+    /// Takes the next size bytes of output.
+    virtual void Write( const char* data, size_t size ) = 0;
+};
+
+
 /**
 	Printing functionality. The XMLPrinter gives you more
 	options than the XMLDocument::Print() method.
@@ -2248,7 +2672,22 @@ public:
     	with only required whitespace and newlines.
     */
     XMLPrinter( FILE* file=0, bool compact = false, int depth = 0 );
-    virtual ~XMLPrinter()	{}
+    /** Construct a printer that collects its output in a large buffer
+        and hands it to the sink whenever the buffer is full, and on
+        Flush() or destruction. Writes larger than the buffer go to the
+        sink directly. Call Flush() before destruction if the sink can
+        throw.
+    */
+    XMLPrinter( XMLSink& sink, bool compact = false, int depth = 0 );
+    virtual ~XMLPrinter();
+
+    /**
+        Hands the buffered output to the sink, if there is one. The
+        buffer is emptied first: an exception thrown by the sink passes
+        through with that output dropped, and destruction then has
+        nothing left to write.
+    */
+    void Flush();
 
     /** If streaming, write the BOM and declaration. */
     void PushHeader( bool writeBOM, bool writeDeclaration );
@@ -2352,6 +2791,7 @@ private:
      */
     void PrepareForNewNode( bool compactMode );
     void PrintString( const char*, bool restrictedEntitySet );	// prints out, after detecting entities.
+    void PushNumberAttribute( const char* name, const char* value );	// no entity check needed
 
     bool _firstElement;
     FILE* _fp;
@@ -2362,12 +2802,16 @@ private:
 
     enum {
         ENTITY_RANGE = 64,
-        BUF_SIZE = 200
+        BUF_SIZE = 200,
+        SINK_BUFFER_SIZE = 64*1024
     };
     bool _entityFlag[ENTITY_RANGE];
     bool _restrictedEntityFlag[ENTITY_RANGE];
 
     DynArray< char, 20 > _buffer;
+    XMLSink* _sink;
+    char* _sinkBuffer;
+    size_t _sinkUsed;
 
     // Prohibit cloning, intentionally not implemented
     XMLPrinter( const XMLPrinter& );